@@ -37,14 +37,15 @@ void isr_usart3_handler() {
     auto rx_data_available = debug_port.read_status_register(HAL::usart::status_register::receive_data_available) > 0;
     auto rx_interrupt_enabled = debug_port.read_control_register(HAL::usart::control_register_1::receive_interrupt_enable) > 0;
     if (rx_data_available && rx_interrupt_enabled) {        
-        debug_port.m_rx_buffer.push_back(static_cast<char>(debug_port.m_peripheral->DR & 0xFFu));
+        // Received bytes are dropped while the receive buffer is full
+        (void)debug_port.m_rx_buffer.push(static_cast<char>(debug_port.m_peripheral->DR & 0xFFu));
     }
 
     // Handle TX Interrupt
     auto tx_data_empty = debug_port.read_status_register(HAL::usart::status_register::transmit_data_empty) > 0;
     auto tx_interrupt_enabled = debug_port.read_control_register(HAL::usart::control_register_1::transmit_interrupt_enable) > 0;    
     if (tx_data_empty && tx_interrupt_enabled) {
-        auto value_to_send = debug_port.m_tx_buffer.pop_back();
+        auto value_to_send = debug_port.m_tx_buffer.pop();
         if (value_to_send.has_value()) {
             auto value = value_to_send.value();
             debug_port.m_peripheral->DR = value;            
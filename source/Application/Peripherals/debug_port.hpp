@@ -10,10 +10,12 @@
 #include "hal_nvic.hpp"
 #include "hal_rcc.hpp"
 #include "device_port.hpp"
-#include "ring_buffer.hpp"
+#include "spsc_ring_buffer.hpp"
+#include <algorithm>
 #include <cstring>
 #include <cstdarg>
 #include <cstdio>
+#include <span>
 #include <utility>
 
 /************************************ Types ********************************************/
@@ -57,7 +59,10 @@ class DebugPort : protected HAL::usart::usart_base {
     }
     
     /**
-     * \brief Log a message over the debug port (printf style)
+     * \brief Log a message over the debug port (printf style). The message is queued for the transmit interrupt
+     *        without masking interrupts, and any part of it that does not fit in the transmit buffer is dropped.
+     *        Only one thread may log at a time, as the threads share the print buffer and the producer side of the
+     *        transmit buffer.
      * 
      * \param message The message/format string to log
      * \param ... Variadic formatting arguments (printf style)
@@ -67,26 +72,21 @@ class DebugPort : protected HAL::usart::usart_base {
         va_start(args, message);         
         auto bytes_to_write = vsnprintf(m_print_buffer, PrintBufferSize, message, args);
         va_end(args);        
-        for (unsigned i = 0; i < static_cast<unsigned>(bytes_to_write); ++i) {
-            m_tx_buffer.push_back(const_cast<char&>(m_print_buffer[i]));            
-        }
+        bytes_to_write = std::clamp(bytes_to_write, 0, static_cast<int>(PrintBufferSize) - 1);
+        m_tx_buffer.push(std::span<const char>(m_print_buffer, static_cast<std::size_t>(bytes_to_write)));
         // Set TX interrupt flag
         write_control_register(HAL::usart::control_register_1::transmit_interrupt_enable, 0x01);
     }
 
     void log_message_test(char* message) {
-        auto bytes_to_write = strlen(message);
-        char* ptr = message;
-        for (unsigned i = 0; i < static_cast<unsigned>(bytes_to_write); ++i) {
-            m_tx_buffer.push_back(const_cast<char&>(*ptr++));
-        }
+        m_tx_buffer.push(std::span<const char>(message, strlen(message)));
         // Set TX interrupt flag
         write_control_register(HAL::usart::control_register_1::transmit_interrupt_enable, 0x01);
     }
 
   private:
-    ring_buffer<char, PrintBufferSize> m_tx_buffer;
-    ring_buffer<char, PrintBufferSize> m_rx_buffer;
+    spsc_ring_buffer<char, PrintBufferSize> m_tx_buffer;  //!< Filled by log_message and drained by the interrupt
+    spsc_ring_buffer<char, PrintBufferSize> m_rx_buffer;  //!< Filled by the interrupt
     char m_print_buffer[PrintBufferSize];
     
     // ISR is a friend of this class so it can directly access the internal buffers
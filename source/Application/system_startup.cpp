@@ -31,9 +31,10 @@ extern "C" void __system_startup() {
     set_bits(SCB->CPACR, (3UL << 10 * 2) | (3UL << 11 * 2));    
 #endif
 
+    // Enable automatic and lazy FPU state preservation so that only threads that use the FPU pay for saving it
+    set_bits(FPU->FPCCR, FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk);
+
     // Enable various fault interrupts   
-    clear_bits(FPU->FPCCR, FPU_FPCCR_LSPEN_Msk); // disable lazy stacking
-    clear_bits(FPU->FPCCR, FPU_FPCCR_ASPEN_Msk);
     set_bits(SCB->SHCSR, SCB_SHCSR_MEMFAULTENA_Msk);
     set_bits(SCB->SHCSR, SCB_SHCSR_BUSFAULTENA_Msk);
     set_bits(SCB->SHCSR, SCB_SHCSR_USGFAULTENA_Msk);
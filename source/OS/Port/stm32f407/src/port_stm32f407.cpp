@@ -2,6 +2,7 @@
 // SPDX-FileCopyrightText: 2023 Graham Riches
 
 #include "port_stm32f407.hpp"
+#include "event_kernel.hpp"
 #include "interrupt_lock_guard.hpp"
 #include "os.hpp"
 #include "stm32f4xx.h"
@@ -59,10 +60,68 @@ void set_pending_context_switch() {
     SCB->ICSR = SCB->ICSR | SCB_ICSR_PENDSVSET_Msk;
 }
 
+//!< Otherwise unused interrupts that run the event tasks, indexed by event task priority
+static constexpr IRQn event_task_interrupts[] = {CAN2_TX_IRQn, CAN2_RX0_IRQn, CAN2_RX1_IRQn, CAN2_SCE_IRQn};
+static_assert(OS_EVENT_TASK_PRIORITIES <= (sizeof(event_task_interrupts) / sizeof(event_task_interrupts[0])),
+              "Not enough interrupts for the event task priority levels");
+
+//!< NVIC priority of the highest priority event task. Event tasks rank above SysTick and PendSV so they preempt threads
+constexpr uint32_t event_task_base_nvic_priority = 10;
+static_assert(event_task_base_nvic_priority + OS_EVENT_TASK_PRIORITIES <= 15,
+              "Event task interrupts must have a higher priority than SysTick and PendSV");
+
+void pend_event_task_interrupt(uint32_t priority) {
+    NVIC_SetPendingIRQ(event_task_interrupts[priority]);
+}
+
 bool is_context_switch_pending() {
     return static_cast<bool>(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk);
 }
 
+uint32_t suppress_ticks_and_sleep(uint32_t idle_ticks) {
+    // The SysTick reload register is only 24 bits, so clamp the sleep to what fits in a single reload
+    const uint32_t cycles_per_tick = SysTick->LOAD + 1;
+    const uint32_t max_idle_ticks = SysTick_LOAD_RELOAD_Msk / cycles_per_tick;
+    idle_ticks = (idle_ticks < max_idle_ticks) ? idle_ticks : max_idle_ticks;
+
+    // Stop the timer and reload it with the whole idle period, keeping the partial tick that was already counted
+    SysTick->CTRL = SysTick->CTRL & ~SysTick_CTRL_ENABLE_Msk;
+    const uint32_t sleep_cycles = SysTick->VAL + (cycles_per_tick * (idle_ticks - 1));
+    SysTick->LOAD = sleep_cycles;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick->CTRL | SysTick_CTRL_ENABLE_Msk;
+
+    // Interrupts are masked so any interrupt wakes the core without running its handler until the kernel
+    // has accounted for the elapsed time
+    __DSB();
+    __WFI();
+    __ISB();
+
+    // Reading the control register clears the count flag, so read it exactly once
+    const uint32_t control = SysTick->CTRL;
+    SysTick->CTRL = control & ~SysTick_CTRL_ENABLE_Msk;
+    uint32_t elapsed_ticks;
+    uint32_t next_reload;
+    if ( (control & SysTick_CTRL_COUNTFLAG_Msk) != 0 ) {
+        // The full idle period expired. The tick is credited here, so drop the pending SysTick interrupt
+        elapsed_ticks = idle_ticks;
+        next_reload = cycles_per_tick - 1;
+        SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+    } else {
+        // Woken early by another interrupt, so only credit the whole ticks that passed and finish the current tick
+        const uint32_t elapsed_cycles = sleep_cycles - SysTick->VAL;
+        elapsed_ticks = elapsed_cycles / cycles_per_tick;
+        next_reload = cycles_per_tick - (elapsed_cycles % cycles_per_tick) - 1;
+    }
+
+    // Run out the remainder of the current tick and then return to the regular tick period on the next reload
+    SysTick->LOAD = next_reload;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick->CTRL | SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = cycles_per_tick - 1;
+    return elapsed_ticks;
+}
+
 void bootstrap_device_port() {
     // Manually set device specific interrupt priorities here
     // Set both SysTick and PendSv to lowest priority
@@ -72,6 +131,12 @@ void bootstrap_device_port() {
     NVIC_EnableIRQ(SysTick_IRQn);    
     NVIC_SetPriority(PendSV_IRQn, priority);
     NVIC_EnableIRQ(PendSV_IRQn);
+
+    // Event tasks nest by priority like any other interrupt
+    for ( uint32_t level = 0; level < OS_EVENT_TASK_PRIORITIES; level++ ) {
+        NVIC_SetPriority(event_task_interrupts[level], NVIC_EncodePriority(0, event_task_base_nvic_priority + level, 1UL));
+        NVIC_EnableIRQ(event_task_interrupts[level]);
+    }
 }
 
 void isr_default_handler() {
@@ -166,29 +231,35 @@ void isr_debug_mon_handler() { }
  * \brief Handling threading context switches which are triggered by the scheduler as pending
  *        system calls. This allows the SysTick interrupt to run at a high priority while the 
  *        context switching can be handled at a lower level.
+ * \note FPU context is only saved for threads that have used the FPU. The hardware clears bit 4 of
+ *       EXC_RETURN for those threads and lazily stacks S0-S15 + FPSCR, so only S16-S31 are saved here.
+ *       Each thread's EXC_RETURN is saved with its context so the matching frame is restored.
+ * \note Threads run on the PSP, so the thread context is saved to and restored from the process stack
+ *       while this handler itself runs on the MSP.
  */
 // clang-format off
 __attribute__((naked)) void isr_pend_sv_handler() {
     using namespace os;
 
     __asm("CPSID      I                        \n"  // Disable interrupts
-          "PUSH       {R4-R11}                 \n"  // Push the remaining core registers
-          "VPUSH      {D0-D15}                 \n"  // Push floating point context
-          "VMRS       R0,fpscr                 \n"  // Get FPU status/control register
-          "PUSH       {R0}                     \n"  // Push floating point control register
-          "LDR        R0, =system_active_task  \n"  // Load the active task pointer into
-          "LDR        R1, [R0]                 \n"  // Dereference the pointer
-          "MOV        R4, SP                   \n"  // Stash the current stack pointer
-          "STR        R4, [R1]                 \n"  // Update the pointer to the current thread task with the current stack pointer
-          "LDR        R1, =system_pending_task \n"  // Get the next task pointer
+          "MRS        R0, PSP                  \n"  // Get the outgoing thread's stack pointer
+          "TST        LR, #0x10                \n"  // Check if the outgoing thread has an FPU frame
+          "IT         EQ                       \n"  //
+          "VSTMDBEQ   R0!, {S16-S31}           \n"  // Push the callee saved floating point registers
+          "STMDB      R0!, {R4-R11, LR}        \n"  // Push the remaining core registers and EXC_RETURN
+          "LDR        R1, =system_active_task  \n"  // Load the active task pointer into
           "LDR        R2, [R1]                 \n"  // Dereference the pointer
-          "STR        R2, [R0]                 \n"  // Update the active thread to be the pending thread
-          "LDR        R4, [R2]                 \n"  // Get the new stack pointer by dereferencing the original pointer
-          "MOV        SP, R4                   \n"  // Push it to the CPU stack pointer register
-          "VPOP       {D0-D15}                 \n"  // Restore floating point context
-          "POP        {R0}                     \n"  // Pop floating point status/control register
-          "VMSR       fpscr, R0                \n"  // Restore floating point control register
-          "POP        {R4-R11}                 \n"  // Pop the stored registers
+          "STR        R0, [R2]                 \n"  // Update the pointer to the current thread task with the current stack pointer
+          "LDR        R3, =system_pending_task \n"  // Get the next task pointer
+          "LDR        R2, [R3]                 \n"  // Dereference the pointer
+          "STR        R2, [R1]                 \n"  // Update the active thread to be the pending thread
+          "LDR        R0, [R2]                 \n"  // Get the new stack pointer by dereferencing the original pointer
+          "LDMIA      R0!, {R4-R11, LR}        \n"  // Pop the stored registers and the thread's EXC_RETURN
+          "TST        LR, #0x10                \n"  // Check if the incoming thread has an FPU frame
+          "IT         EQ                       \n"  //
+          "VLDMIAEQ   R0!, {S16-S31}           \n"  // Restore the callee saved floating point registers
+          "MSR        PSP, R0                  \n"  // Hand the incoming thread's stack back to the process stack pointer
+          "ISB                                 \n"  //
           "CPSIE      I                        \n"  // Re-enable interrupts
           "BX         LR                       \n"  // Return
     );
@@ -206,6 +277,25 @@ void isr_systick_handler() {
     os::scheduler::update();
 }
 
+/**
+ * \brief Interrupts that run the event tasks at each priority level to completion on the main stack
+ */
+void isr_event_task_0_handler() {
+    os::event_kernel::get().dispatch(0);
+}
+
+void isr_event_task_1_handler() {
+    os::event_kernel::get().dispatch(1);
+}
+
+void isr_event_task_2_handler() {
+    os::event_kernel::get().dispatch(2);
+}
+
+void isr_event_task_3_handler() {
+    os::event_kernel::get().dispatch(3);
+}
+
 /**
  * \brief custom hardfault handler to save the register state
  * 
@@ -311,10 +401,10 @@ __attribute__((used, section(".vectors"))) isr_handler_function vectors[STM32F4_
     isr_default_handler,  // dma_2_stream_4
     isr_default_handler,  // ethernet
     isr_default_handler,  // ethernet_wakeup
-    isr_default_handler,  // can_2_tx
-    isr_default_handler,  // can_2_rx_0
-    isr_default_handler,  // can_2_rx_1
-    isr_default_handler,  // can_2_sce
+    isr_event_task_0_handler,  // can_2_tx
+    isr_event_task_1_handler,  // can_2_rx_0
+    isr_event_task_2_handler,  // can_2_rx_1
+    isr_event_task_3_handler,  // can_2_sce
     isr_default_handler,  // otg_fs
     isr_default_handler,  // dma_2_stream_5
     isr_default_handler,  // dma_2_stream_6
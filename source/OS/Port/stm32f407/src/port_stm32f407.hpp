@@ -134,5 +134,21 @@ void set_pending_context_switch();
  */
 bool is_context_switch_pending();
 
+/**
+ * \brief Stop the SysTick interrupt and sleep (WFI) for up to a number of ticks (platform dependent).
+ *        Must be called with interrupts disabled.
+ * 
+ * \param idle_ticks Maximum number of ticks to sleep for
+ * \retval uint32_t Number of whole ticks that elapsed while sleeping
+ */
+uint32_t suppress_ticks_and_sleep(uint32_t idle_ticks);
+
+/**
+ * \brief Pend the interrupt tied to an event task priority level (platform dependent)
+ * 
+ * \param priority Event task priority level
+ */
+void pend_event_task_interrupt(uint32_t priority);
+
 // TODO: Should this be here? probably not
 void isr_usart3_handler();
\ No newline at end of file
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "device_port.hpp"
+#include "scheduler_impl.hpp"
+#include "sleep_list.hpp"
+#include "task_control_block.hpp"
+#include "wait_queue.hpp"
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief Block the calling thread on a wait queue until a condition clears, for buffers whose waiting threads check
+ *        the buffer again once they run rather than being handed what they waited for. A thread that is woken up but
+ *        finds the condition still set, because a thread that never blocked got there first, waits again for the rest
+ *        of its timeout. Must be called with interrupts disabled, which are re-enabled while the thread is blocked.
+ *
+ * \param scheduler The scheduler running the calling thread
+ * \param waiters The wait queue to block on
+ * \param blocked Returns true while the thread has to keep waiting
+ * \param timeout Max ticks to wait for, or scheduler_impl::wait_forever
+ * \retval bool True once the condition has cleared, false if the wait timed out
+ */
+template <typename Condition>
+bool wait_while(scheduler_impl& scheduler, wait_queue& waiters, Condition blocked, uint32_t timeout) {
+    const uint32_t deadline = scheduler.get_elapsed_ticks() + timeout;
+    while ( blocked() ) {
+        scheduler.block_on(waiters, timeout);
+        ENABLE_INTERRUPTS();
+
+        // Running again, either woken by the other side of the buffer or after the timeout
+        DISABLE_INTERRUPTS();
+        if ( scheduler.get_active_tcb_ptr()->wait_status != wait_result::signaled ) {
+            return false;
+        }
+        if ( timeout != scheduler_impl::wait_forever ) {
+            auto now = scheduler.get_elapsed_ticks();
+            timeout = sleep_list::tick_reached(now, deadline) ? 0 : deadline - now;
+        }
+    }
+    return true;
+}
+
+};  // namespace os
@@ -0,0 +1,563 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "coroutine_wait_list.hpp"
+#include "interrupt_lock_guard.hpp"
+#include "scheduler.hpp"
+#include "semaphore.hpp"
+#include "sleep_list.hpp"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#if !defined(OS_COROUTINE_FRAME_SIZE)
+//!< Size in bytes of each coroutine frame in the frame pool. A coroutine whose frame does not fit cannot be started
+#define OS_COROUTINE_FRAME_SIZE 256
+#endif
+
+#if !defined(OS_COROUTINE_FRAME_COUNT)
+//!< Number of coroutine frames in the frame pool, which limits how many coroutines can exist at once
+#define OS_COROUTINE_FRAME_COUNT 32
+#endif
+
+namespace os
+{
+
+/**
+ * \brief Fixed pool of equally sized blocks for coroutine frames so that starting a coroutine never touches the heap.
+ *        Blocks are handed out from the unused part of the pool first and recycled through an intrusive free list.
+ *
+ * \tparam FrameSize Size of each block in bytes
+ * \tparam FrameCount Number of blocks
+ */
+template <std::size_t FrameSize, std::size_t FrameCount>
+class coroutine_frame_pool {
+    static_assert(FrameSize >= sizeof(void*), "Frames must be able to hold a free list link");
+    static_assert(FrameCount > 0, "coroutine_frame_pool must hold at least one frame");
+
+  public:
+    //!< Block size rounded up so that every block is aligned for any frame
+    static constexpr std::size_t block_size =
+        (FrameSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    constexpr coroutine_frame_pool() = default;
+
+    coroutine_frame_pool(const coroutine_frame_pool&) = delete;
+    coroutine_frame_pool& operator=(const coroutine_frame_pool&) = delete;
+
+    /**
+     * \brief Allocate a frame
+     *
+     * \param size Size of the frame in bytes
+     * \retval void* The frame, or nullptr if it is too large or the pool is empty
+     */
+    void* allocate(std::size_t size) {
+        if ( size > block_size ) {
+            return nullptr;
+        }
+        os::interrupt_guard guard;
+        void* block = nullptr;
+        if ( m_free != nullptr ) {
+            block = m_free;
+            m_free = m_free->next;
+        } else if ( m_unused < FrameCount ) {
+            block = &m_storage[m_unused * block_size];
+            m_unused++;
+        }
+        if ( block != nullptr ) {
+            m_in_use++;
+        }
+        return block;
+    }
+
+    /**
+     * \brief Return a frame to the pool
+     *
+     * \param frame The frame
+     */
+    void deallocate(void* frame) {
+        os::interrupt_guard guard;
+        auto* block = static_cast<free_block*>(frame);
+        block->next = m_free;
+        m_free = block;
+        m_in_use--;
+    }
+
+    /**
+     * \brief Get the number of frames in use
+     *
+     * \retval std::size_t Frames in use
+     */
+    std::size_t in_use() const {
+        return m_in_use;
+    }
+
+  private:
+    struct free_block {
+        free_block* next;
+    };
+
+    alignas(std::max_align_t) std::byte m_storage[block_size * FrameCount] = {};
+    free_block* m_free = nullptr;
+    std::size_t m_unused = 0;
+    std::size_t m_in_use = 0;
+};
+
+//!< Pool that every os::task frame is allocated from
+inline coroutine_frame_pool<OS_COROUTINE_FRAME_SIZE, OS_COROUTINE_FRAME_COUNT> coroutine_frames;
+
+class coroutine_executor;
+
+namespace detail
+{
+/**
+ * \brief Promise state shared by every os::task result type
+ */
+class task_promise_base {
+  public:
+    static void* operator new(std::size_t size) noexcept {
+        return coroutine_frames.allocate(size);
+    }
+
+    static void operator delete(void* frame) noexcept {
+        coroutine_frames.deallocate(frame);
+    }
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    /**
+     * \brief At the end of the coroutine resume the coroutine that awaited it, or free the frame of a coroutine that
+     *        was spawned onto an executor
+     */
+    struct final_awaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto& promise = handle.promise();
+            if ( promise.m_continuation ) {
+                return promise.m_continuation;
+            }
+            if ( promise.m_detached ) {
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept { }
+    };
+
+    final_awaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        std::terminate();
+    }
+
+    /**
+     * \brief Fill in the waiter node of an awaitable so that the kernel object it waits on can hand the coroutine back
+     *        to its executor
+     *
+     * \param waiter The waiter node
+     * \param handle The suspending coroutine
+     */
+    void prepare_waiter(coroutine_waiter& waiter, std::coroutine_handle<> handle);
+
+    coroutine_executor* m_executor = nullptr;
+    std::coroutine_handle<> m_continuation;
+    coroutine_waiter m_start;
+    bool m_detached = false;
+};
+};  // namespace detail
+
+/**
+ * \brief Lazily started coroutine that runs on a coroutine_executor. A task starts when it is spawned onto an executor
+ *        or awaited by another task, and can await os::this_coroutine::sleep_for_msec, semaphore acquire_async and
+ *        mutex lock_async without blocking the executor thread. Frames come from the fixed coroutine frame pool; a
+ *        task whose frame could not be allocated is not valid and cannot be started. Awaiting a task gives an
+ *        std::optional of its result, which is empty if the task was not valid and so never ran.
+ *
+ * \tparam T Result type of the coroutine
+ */
+template <typename T = void>
+class task {
+  public:
+    struct promise_type : detail::task_promise_base {
+        static task get_return_object_on_allocation_failure() noexcept {
+            return task();
+        }
+
+        task get_return_object() noexcept {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        template <typename U>
+        void return_value(U&& value) {
+            m_result.emplace(std::forward<U>(value));
+        }
+
+        std::optional<T> m_result;
+    };
+
+    task() = default;
+
+    task(task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) { }
+
+    task& operator=(task&& other) noexcept {
+        if ( this != &other ) {
+            reset();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() {
+        reset();
+    }
+
+    /**
+     * \brief Check if the task has a coroutine frame
+     *
+     * \retval bool False if the frame pool was exhausted when the task was created
+     */
+    bool valid() const {
+        return static_cast<bool>(m_handle);
+    }
+
+    /**
+     * \brief Start the awaited task and resume the awaiting coroutine with its result once it is done. A task that is
+     *        not valid completes straight away without a result.
+     */
+    bool await_ready() const noexcept {
+        return !m_handle || m_handle.done();
+    }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+        m_handle.promise().m_executor = awaiting.promise().m_executor;
+        m_handle.promise().m_continuation = awaiting;
+        return m_handle;
+    }
+
+    std::optional<T> await_resume() {
+        if ( !m_handle ) {
+            return {};
+        }
+        return std::move(m_handle.promise().m_result);
+    }
+
+  private:
+    friend class coroutine_executor;
+
+    explicit task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle) { }
+
+    void reset() {
+        if ( m_handle ) {
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/**
+ * \brief Coroutine task without a result
+ */
+template <>
+class task<void> {
+  public:
+    struct promise_type : detail::task_promise_base {
+        static task get_return_object_on_allocation_failure() noexcept {
+            return task();
+        }
+
+        task get_return_object() noexcept {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        void return_void() noexcept { }
+    };
+
+    task() = default;
+
+    task(task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) { }
+
+    task& operator=(task&& other) noexcept {
+        if ( this != &other ) {
+            reset();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() {
+        reset();
+    }
+
+    bool valid() const {
+        return static_cast<bool>(m_handle);
+    }
+
+    /**
+     * \brief Start the awaited task and resume the awaiting coroutine once it is done. Awaiting gives true if the task
+     *        ran, or false if it was not valid and so never ran.
+     */
+    bool await_ready() const noexcept {
+        return !m_handle || m_handle.done();
+    }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+        m_handle.promise().m_executor = awaiting.promise().m_executor;
+        m_handle.promise().m_continuation = awaiting;
+        return m_handle;
+    }
+
+    bool await_resume() const noexcept {
+        return valid();
+    }
+
+  private:
+    friend class coroutine_executor;
+
+    explicit task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle) { }
+
+    void reset() {
+        if ( m_handle ) {
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/**
+ * \brief Runs coroutines on a single kernel thread. Suspended coroutines wait in the executor's timer list or in the
+ *        coroutine wait lists of the semaphores and mutexes they are waiting on, and are handed back to the executor
+ *        when they can continue. While no coroutine is ready, the executor thread blocks in the kernel until the next
+ *        coroutine timer expires or a coroutine is woken, so hundreds of state machines can share one thread stack.
+ */
+class coroutine_executor {
+  public:
+    /**
+     * \brief Create an executor managed by the os scheduler
+     */
+    coroutine_executor()
+        : coroutine_executor(scheduler::get()) { }
+
+    /**
+     * \brief Create an executor managed by a specific scheduler
+     *
+     * \param scheduler The scheduler that runs the executor thread
+     */
+    explicit coroutine_executor(scheduler_impl& scheduler)
+        : m_scheduler(&scheduler)
+        , m_wakeup(scheduler, 0) { }
+
+    coroutine_executor(const coroutine_executor&) = delete;
+    coroutine_executor& operator=(const coroutine_executor&) = delete;
+
+    /**
+     * \brief Hand a task to the executor to run. The executor owns the task and frees its frame when it finishes
+     *
+     * \param coroutine The task to run
+     * \retval bool False if the task has no frame because the frame pool was exhausted
+     */
+    bool spawn(task<void>&& coroutine) {
+        if ( !coroutine.valid() ) {
+            return false;
+        }
+        auto handle = std::exchange(coroutine.m_handle, nullptr);
+        auto& promise = handle.promise();
+        promise.m_executor = this;
+        promise.m_detached = true;
+        promise.prepare_waiter(promise.m_start, handle);
+        schedule(promise.m_start);
+        return true;
+    }
+
+    /**
+     * \brief Resume every coroutine that is ready to run, including coroutines whose sleep has expired. Must be called
+     *        from the executor thread.
+     *
+     * \retval uint32_t Ticks until the next coroutine timer expires, or scheduler_impl::wait_forever if none are set
+     */
+    uint32_t poll() {
+        m_thread = m_scheduler->get_active_tcb_ptr();
+        uint32_t now = m_scheduler->get_elapsed_ticks();
+        wake_expired_sleepers(now);
+        while ( auto* waiter = next_ready() ) {
+            waiter->handle.resume();
+        }
+
+        os::interrupt_guard guard;
+        if ( m_sleeping == nullptr ) {
+            return scheduler_impl::wait_forever;
+        }
+        now = m_scheduler->get_elapsed_ticks();
+        return sleep_list::tick_reached(now, m_sleeping->wake_tick) ? 0 : m_sleeping->wake_tick - now;
+    }
+
+    /**
+     * \brief Run the executor forever. Call this from the task function of the thread that should run the coroutines
+     */
+    [[noreturn]] void run() {
+        while ( true ) {
+            auto ticks = poll();
+            if ( ticks == scheduler_impl::wait_forever ) {
+                m_wakeup.acquire();
+            } else if ( ticks > 0 ) {
+                (void)m_wakeup.try_acquire_for(ticks);
+            }
+        }
+    }
+
+    /**
+     * \brief Get the thread that runs the executor
+     *
+     * \retval task_control_block* The executor thread, or nullptr if the executor has not run yet
+     */
+    task_control_block* get_thread() const {
+        return m_thread;
+    }
+
+    /**
+     * \brief Get the scheduler that runs the executor thread
+     *
+     * \retval scheduler_impl& The scheduler
+     */
+    scheduler_impl& get_scheduler() {
+        return *m_scheduler;
+    }
+
+    /**
+     * \brief Queue a suspended coroutine to be resumed by its executor. This is the wake function of every coroutine
+     *        waiter and may be called from threads and interrupts. Must be called with interrupts disabled, which it
+     *        leaves disabled so that the caller's critical section is not cut short.
+     *
+     * \param waiter The waiter node of the coroutine
+     */
+    static void wake_locked(coroutine_waiter& waiter) {
+        static_cast<coroutine_executor*>(waiter.executor)->schedule_locked(waiter);
+    }
+
+    /**
+     * \brief Park a coroutine in the timer list until a tick
+     *
+     * \param waiter The waiter node of the coroutine, with its wake tick set
+     */
+    void sleep_until(coroutine_waiter& waiter) {
+        os::interrupt_guard guard;
+        auto** link = &m_sleeping;
+        while ( (*link != nullptr) && sleep_list::tick_reached(waiter.wake_tick, (*link)->wake_tick) ) {
+            link = &(*link)->next;
+        }
+        waiter.next = *link;
+        *link = &waiter;
+    }
+
+  private:
+    void schedule(coroutine_waiter& waiter) {
+        os::interrupt_guard guard;
+        schedule_locked(waiter);
+    }
+
+    void schedule_locked(coroutine_waiter& waiter) {
+        m_ready.push_back(waiter);
+        m_wakeup.release_locked();
+    }
+
+    coroutine_waiter* next_ready() {
+        os::interrupt_guard guard;
+        return m_ready.pop_front();
+    }
+
+    void wake_expired_sleepers(uint32_t now) {
+        os::interrupt_guard guard;
+        while ( (m_sleeping != nullptr) && sleep_list::tick_reached(now, m_sleeping->wake_tick) ) {
+            auto* waiter = m_sleeping;
+            m_sleeping = waiter->next;
+            m_ready.push_back(*waiter);
+        }
+    }
+
+    scheduler_impl* m_scheduler;
+    binary_semaphore m_wakeup;
+    coroutine_wait_list m_ready;
+    coroutine_waiter* m_sleeping = nullptr;
+    task_control_block* m_thread = nullptr;
+};
+
+inline void detail::task_promise_base::prepare_waiter(coroutine_waiter& waiter, std::coroutine_handle<> handle) {
+    waiter.handle = handle;
+    waiter.wake_locked = &coroutine_executor::wake_locked;
+    waiter.executor = m_executor;
+    waiter.thread = m_executor->get_thread();
+}
+
+namespace this_coroutine
+{
+
+/**
+ * \brief Awaitable that suspends the calling coroutine for a number of ticks without blocking its executor thread
+ */
+class sleep_awaiter {
+  public:
+    explicit sleep_awaiter(uint32_t ticks)
+        : m_ticks(ticks) { }
+
+    bool await_ready() const {
+        return m_ticks == 0;
+    }
+
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle) {
+        auto& promise = handle.promise();
+        promise.prepare_waiter(m_waiter, handle);
+        m_waiter.wake_tick = promise.m_executor->get_scheduler().get_elapsed_ticks() + m_ticks;
+        promise.m_executor->sleep_until(m_waiter);
+    }
+
+    void await_resume() { }
+
+  private:
+    uint32_t m_ticks;
+    coroutine_waiter m_waiter;
+};
+
+/**
+ * \brief Sleep the calling coroutine, the coroutine counterpart of os::this_thread::sleep_for_msec
+ *
+ * \param duration_msec Duration of the sleep in milliseconds
+ * \return sleep_awaiter Awaitable that completes once the sleep is over
+ */
+[[nodiscard]] inline sleep_awaiter sleep_for_msec(uint32_t duration_msec) {
+    return sleep_awaiter(duration_msec);
+}
+
+}  // namespace this_coroutine
+
+};  // namespace os
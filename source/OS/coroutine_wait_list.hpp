@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "task_control_block.hpp"
+#include <coroutine>
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief A suspended coroutine waiting on a kernel object. The node lives in the coroutine frame for as long as the
+ *        coroutine is suspended, so waiting never allocates. Kernel objects wake the coroutine through the wake_locked
+ *        function from inside their own critical section, and it hands the coroutine back to the executor that runs it
+ *        without re-enabling interrupts.
+ */
+struct coroutine_waiter {
+    using wake_function = void (*)(coroutine_waiter& waiter);
+
+    std::coroutine_handle<> handle;        //!< The suspended coroutine
+    wake_function wake_locked = nullptr;   //!< Schedules the coroutine to be resumed, called with interrupts disabled
+    void* executor = nullptr;              //!< Executor that resumes the coroutine
+    task_control_block* thread = nullptr;  //!< Thread that runs the executor, which owns locks taken by the coroutine
+    uint32_t wake_tick = 0;                //!< Tick to wake a sleeping coroutine at
+    coroutine_waiter* next = nullptr;
+};
+
+/**
+ * \brief FIFO list of suspended coroutines, linked through the waiter nodes in their frames
+ */
+class coroutine_wait_list {
+  public:
+    constexpr coroutine_wait_list() = default;
+
+    coroutine_wait_list(const coroutine_wait_list&) = delete;
+    coroutine_wait_list& operator=(const coroutine_wait_list&) = delete;
+
+    bool empty() const {
+        return m_head == nullptr;
+    }
+
+    void push_back(coroutine_waiter& waiter) {
+        waiter.next = nullptr;
+        if ( m_tail != nullptr ) {
+            m_tail->next = &waiter;
+        } else {
+            m_head = &waiter;
+        }
+        m_tail = &waiter;
+    }
+
+    coroutine_waiter* pop_front() {
+        auto* waiter = m_head;
+        if ( waiter != nullptr ) {
+            m_head = waiter->next;
+            if ( m_head == nullptr ) {
+                m_tail = nullptr;
+            }
+            waiter->next = nullptr;
+        }
+        return waiter;
+    }
+
+  private:
+    coroutine_waiter* m_head = nullptr;
+    coroutine_waiter* m_tail = nullptr;
+};
+
+};  // namespace os
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "thread.hpp"
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief CPU budget shared by a group of threads. Every tick that a thread of the group is running is charged to the
+ *        budget. The replenishment period starts on the first tick charged after the budget was last replenished, so
+ *        a group that has been idle gets its full budget back for its next burst, like a sporadic server. Once the
+ *        budget is used up, the threads of the group are demoted to the throttled priority until the end of the
+ *        period. Demoted threads still run when nothing more important is ready, and they are still boosted through
+ *        any locks that higher priority threads wait on.
+ */
+struct cpu_budget {
+    /**
+     * \brief Create a new budget group
+     * 
+     * \param budget_ticks Ticks the threads of the group may run for in each replenishment period
+     * \param period_ticks Length of the replenishment period in ticks
+     * \param throttled_priority Priority the threads of the group drop to once the budget is used up
+     */
+    constexpr cpu_budget(uint32_t budget_ticks, uint32_t period_ticks, uint32_t throttled_priority = thread::lowest_priority)
+        : budget(budget_ticks)
+        , period(period_ticks)
+        , throttled_priority(throttled_priority)
+        , remaining(budget_ticks) { }
+
+    // Threads and the scheduler refer to the budget so it cannot be copied or moved
+    cpu_budget(const cpu_budget&) = delete;
+    cpu_budget& operator=(const cpu_budget&) = delete;
+
+    uint32_t budget;              //!< Ticks available in each replenishment period
+    uint32_t period;              //!< Length of the replenishment period in ticks
+    uint32_t throttled_priority;  //!< Priority of the group's threads while the budget is exhausted
+    uint32_t remaining;           //!< Ticks left in the current period
+    uint32_t replenish_tick = 0;  //!< Tick the budget is replenished on, valid while the period is running
+    bool period_running = false;  //!< The budget has been charged since it was last replenished
+    bool exhausted = false;       //!< The budget is used up and the group's threads are throttled
+    uint32_t overruns = 0;        //!< Number of periods in which the group used up its budget
+    cpu_budget* next = nullptr;   //!< Next budget group known to the scheduler
+};
+
+};  // namespace os
@@ -6,5 +6,59 @@
 #if defined(STM32F407xx)
 #include "stm32f4xx.h"
 #include "port_stm32f407.hpp"
+
+namespace os::port
+{
+/**
+ * \brief Disable interrupts and return the previous PRIMASK so that the caller's interrupt state can be restored
+ *
+ * \retval uint32_t The previous PRIMASK, 1 if interrupts were already disabled
+ */
+inline uint32_t save_and_disable_interrupts() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+/**
+ * \brief Restore the interrupt state saved by save_and_disable_interrupts
+ *
+ * \param primask The saved PRIMASK
+ */
+inline void restore_interrupts(uint32_t primask) {
+    __set_PRIMASK(primask);
+}
+};  // namespace os::port
+#else
+#include <cstdint>
+
+// Host builds run the kernel from a single thread for unit testing, so there are no interrupts to mask. The mask
+// state is still tracked and re-enabling interrupts is counted, so that tests can check that a critical section is not
+// ended early by a nested one
+namespace os::port
+{
+inline uint32_t interrupt_enable_count = 0;
+inline bool interrupts_masked = false;
+
+inline void enable_interrupts() {
+    interrupts_masked = false;
+    interrupt_enable_count++;
+}
+
+inline uint32_t save_and_disable_interrupts() {
+    uint32_t primask = interrupts_masked ? 1 : 0;
+    interrupts_masked = true;
+    return primask;
+}
+
+inline void restore_interrupts(uint32_t primask) {
+    if ( primask == 0 ) {
+        enable_interrupts();
+    }
+}
+};  // namespace os::port
+
+#define DISABLE_INTERRUPTS() (os::port::interrupts_masked = true)
+#define ENABLE_INTERRUPTS() os::port::enable_interrupts()
 #endif
 
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "task_control_block.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief Earliest deadline first scheduling. The ready thread with the nearest absolute deadline always runs. Ready
+ *        threads are kept in a fixed capacity binary min-heap, so making a thread ready or blocking it is O(log n)
+ *        and picking the next thread is O(1). Threads without a deadline (no period set) run in the background by
+ *        priority once no thread with a deadline is ready. Deadlines are compared with wrapping arithmetic.
+ *
+ *        A thread that is still running after its deadline is counted as a deadline miss in the tick path, and a
+ *        thread that finishes its job after the deadline without having been counted is counted when it finishes.
+ *        The heap holds up to max_ready_threads threads, which static_scheduler checks against its thread count at
+ *        compile time.
+ */
+class edf_policy {
+    static_assert(MAX_THREAD_COUNT > 0, "edf_policy needs room for at least one thread");
+
+  public:
+    //!< Max number of ready threads the heap holds
+    static constexpr std::size_t max_ready_threads = MAX_THREAD_COUNT;
+
+    /**
+     * \brief Check if a thread should run before another thread
+     *
+     * \param lhs The first thread
+     * \param rhs The second thread
+     * \retval bool True if lhs should run first
+     */
+    static bool runs_before(const task_control_block* lhs, const task_control_block* rhs) {
+        const bool lhs_has_deadline = lhs->relative_deadline != 0;
+        const bool rhs_has_deadline = rhs->relative_deadline != 0;
+        if ( lhs_has_deadline != rhs_has_deadline ) {
+            return lhs_has_deadline;
+        }
+        if ( lhs_has_deadline && (lhs->absolute_deadline != rhs->absolute_deadline) ) {
+            return static_cast<int32_t>(lhs->absolute_deadline - rhs->absolute_deadline) < 0;
+        }
+        if ( lhs->priority != rhs->priority ) {
+            return lhs->priority < rhs->priority;
+        }
+        // Break ties on a fixed order so that the running thread is not switched out for an equal thread
+        return lhs < rhs;
+    }
+
+    void on_ready(task_control_block* tcb) {
+        // Only reachable with more threads than the heap holds, which static_scheduler rejects
+        if ( m_size == max_ready_threads ) {
+            return;
+        }
+        auto index = m_size++;
+        m_heap[index] = tcb;
+        tcb->heap_index = static_cast<uint32_t>(index);
+        sift_up(index);
+    }
+
+    void on_block(task_control_block* tcb) {
+        std::size_t index = tcb->heap_index;
+        auto* last = m_heap[--m_size];
+        if ( index == m_size ) {
+            return;
+        }
+        m_heap[index] = last;
+        last->heap_index = static_cast<uint32_t>(index);
+        sift_up(index);
+        sift_down(last->heap_index);
+    }
+
+    task_control_block* pick_next() const {
+        return (m_size > 0) ? m_heap[0] : nullptr;
+    }
+
+    void on_tick(task_control_block* active, uint32_t now) {
+        if ( (active->relative_deadline != 0) && !active->deadline_missed &&
+             (static_cast<int32_t>(now - active->absolute_deadline) > 0) ) {
+            active->deadline_missed = true;
+            active->deadline_misses++;
+        }
+    }
+
+    void on_dispatch(task_control_block* tcb, uint32_t now) {
+        (void)tcb;
+        (void)now;
+    }
+
+  private:
+    void swap(std::size_t a, std::size_t b) {
+        auto* tcb = m_heap[a];
+        m_heap[a] = m_heap[b];
+        m_heap[b] = tcb;
+        m_heap[a]->heap_index = static_cast<uint32_t>(a);
+        m_heap[b]->heap_index = static_cast<uint32_t>(b);
+    }
+
+    void sift_up(std::size_t index) {
+        while ( index > 0 ) {
+            auto parent = (index - 1) / 2;
+            if ( !runs_before(m_heap[index], m_heap[parent]) ) {
+                return;
+            }
+            swap(index, parent);
+            index = parent;
+        }
+    }
+
+    void sift_down(std::size_t index) {
+        while ( true ) {
+            auto first = index;
+            auto left = 2 * index + 1;
+            auto right = left + 1;
+            if ( (left < m_size) && runs_before(m_heap[left], m_heap[first]) ) {
+                first = left;
+            }
+            if ( (right < m_size) && runs_before(m_heap[right], m_heap[first]) ) {
+                first = right;
+            }
+            if ( first == index ) {
+                return;
+            }
+            swap(index, first);
+            index = first;
+        }
+    }
+
+    std::array<task_control_block*, max_ready_threads> m_heap = {};
+    std::size_t m_size = 0;
+};
+
+};  // namespace os
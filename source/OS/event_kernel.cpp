@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "event_kernel.hpp"
+#include "device_port.hpp"
+
+namespace os
+{
+
+event_kernel::event_kernel()
+    : basic_event_kernel(pend_event_task_interrupt) { }
+
+event_kernel& event_kernel::get() {
+    static event_kernel kernel;
+    return kernel;
+}
+
+bool event_kernel::register_new_task(event_task& task) {
+    return get().register_task(task);
+}
+
+bool event_kernel::post_signal(event_task& task, event_task::signal sig) {
+    return get().post(task, sig);
+}
+
+};  // namespace os
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "event_task.hpp"
+#include <cstdint>
+
+#if !defined(OS_EVENT_TASK_PRIORITIES)
+//!< Number of event task priority levels. The device port ties one interrupt to each level
+#define OS_EVENT_TASK_PRIORITIES 4
+#endif
+
+namespace os
+{
+
+/**
+ * \brief Singleton accessor for the event task kernel
+ */
+class event_kernel : public basic_event_kernel<OS_EVENT_TASK_PRIORITIES> {
+  public:
+    /**
+     * \brief Singleton accessor for the event kernel
+     * 
+     * \retval event_kernel& Reference to the event kernel
+     */
+    static event_kernel& get();
+
+    /**
+     * \brief Register a run-to-completion task
+     * 
+     * \param task The task to register
+     * \retval bool True if the task was registered
+     */
+    static bool register_new_task(event_task& task);
+
+    /**
+     * \brief Post a signal to a run-to-completion task
+     * 
+     * \param task The task to signal
+     * \param sig The signal
+     * \retval bool True if the signal was queued
+     */
+    static bool post_signal(event_task& task, event_task::signal sig);
+
+  private:
+    /**
+     * \brief Construct the event kernel as a singleton instance
+     */
+    event_kernel();
+};
+
+};  // namespace os
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "device_port.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace os
+{
+
+/**
+ * \brief Run-to-completion task. An event task has no stack or saved context of its own: each signal posted to it is
+ *        handled by a plain function call on the main stack, and the handler must return without blocking. Event
+ *        tasks are much lighter than threads, so they suit large numbers of short event handlers.
+ */
+class event_task {
+  public:
+    //!< Signals are small integers so that posting one never allocates or copies a large event
+    using signal = uint32_t;
+
+    //!< Function called to handle each signal posted to the task
+    using handler = void (*)(event_task& task, signal sig);
+
+    /**
+     * \brief Create a new event task
+     * 
+     * \param handler Function that handles the signals posted to the task
+     * \param priority Priority of the task, zero is the highest
+     * \param queue Storage for signals that have been posted but not handled yet
+     */
+    event_task(handler handler, uint32_t priority, std::span<signal> queue)
+        : m_handler(handler)
+        , m_priority(priority)
+        , m_queue(queue) { }
+
+    // The kernel refers to registered tasks so they cannot be copied or moved
+    event_task(const event_task&) = delete;
+    event_task& operator=(const event_task&) = delete;
+
+    /**
+     * \brief Get the task priority
+     * 
+     * \retval uint32_t The priority, zero is the highest
+     */
+    uint32_t get_priority() const {
+        return m_priority;
+    }
+
+    /**
+     * \brief Get the number of signals waiting to be handled
+     * 
+     * \retval std::size_t Number of queued signals
+     */
+    std::size_t get_queued_count() const {
+        return m_count;
+    }
+
+  private:
+    template <std::size_t Levels>
+    friend class basic_event_kernel;
+
+    bool push(signal sig) {
+        if ( m_count == m_queue.size() ) {
+            return false;
+        }
+        m_queue[(m_head + m_count) % m_queue.size()] = sig;
+        m_count++;
+        return true;
+    }
+
+    bool pop(signal& sig) {
+        if ( m_count == 0 ) {
+            return false;
+        }
+        sig = m_queue[m_head];
+        m_head = (m_head + 1) % m_queue.size();
+        m_count--;
+        return true;
+    }
+
+    handler m_handler;
+    uint32_t m_priority;
+    std::span<signal> m_queue;
+    std::size_t m_head = 0;
+    std::size_t m_count = 0;
+};
+
+/**
+ * \brief Signal queue storage for an event task. This is kept as a separate base class so that the storage is
+ *        constructed before the task that refers to it
+ *
+ * \tparam QueueDepth Number of signals that can be queued
+ */
+template <std::size_t QueueDepth>
+struct event_queue_storage {
+    std::array<event_task::signal, QueueDepth> m_queue_storage = {};
+};
+
+/**
+ * \brief Event task with its signal queue allocated inline
+ *
+ * \tparam QueueDepth Number of signals that can be queued before posting fails
+ */
+template <std::size_t QueueDepth>
+class static_event_task : private event_queue_storage<QueueDepth>, public event_task {
+    static_assert(QueueDepth > 0, "static_event_task must be able to queue at least one signal");
+
+  public:
+    /**
+     * \brief Create a new event task
+     * 
+     * \param handler Function that handles the signals posted to the task
+     * \param priority Priority of the task, zero is the highest
+     */
+    static_event_task(handler handler, uint32_t priority)
+        : event_queue_storage<QueueDepth>()
+        , event_task(handler, priority, this->m_queue_storage) { }
+};
+
+/**
+ * \brief Kernel for run-to-completion event tasks in the style of the Super Simple Tasker. Each task priority level is
+ *        tied to an interrupt whose hardware priority matches the task priority, and posting a signal pends that
+ *        interrupt. The interrupt controller then does all of the scheduling: a task preempts lower priority tasks and
+ *        every thread by nesting like any other interrupt, and runs to completion on the main stack. Event tasks
+ *        coexist with regular threads, which run whenever no event task has work to do.
+ *
+ * \tparam Levels Number of task priority levels, one task per level
+ */
+template <std::size_t Levels>
+class basic_event_kernel {
+    static_assert(Levels > 0, "basic_event_kernel must support at least one priority level");
+
+  public:
+    /**
+    * \brief Function pointer to pend the interrupt tied to a task priority level. The handler for that interrupt must
+    *        call dispatch with the same priority. This injects the HW dependency into the kernel at run-time so that it
+    *        can be tested more easily.
+    */
+    using pend_interrupt = void (*)(uint32_t priority);
+
+    //!< Active priority while no event task is running
+    static constexpr uint32_t idle_priority = Levels;
+
+    /**
+     * \brief Construct a new event kernel
+     * 
+     * \param pend Function pointer to pend the interrupt for a task priority level
+     */
+    explicit basic_event_kernel(pend_interrupt pend)
+        : m_pend(pend) { }
+
+    basic_event_kernel(const basic_event_kernel&) = delete;
+    basic_event_kernel& operator=(const basic_event_kernel&) = delete;
+
+    /**
+     * \brief Register a task at its priority level
+     * 
+     * \param task The task to register
+     * \retval bool True if the priority is valid and no other task has it
+     */
+    bool register_task(event_task& task) {
+        auto priority = task.get_priority();
+        if ( (priority >= Levels) || (m_tasks[priority] != nullptr) ) {
+            return false;
+        }
+        m_tasks[priority] = &task;
+        return true;
+    }
+
+    /**
+     * \brief Post a signal to a task. This can be called from threads, interrupts and other event tasks. The task runs
+     *        straight away if it has a higher priority than the caller, or once the caller is done otherwise.
+     * 
+     * \param task The task to signal
+     * \param sig The signal
+     * \retval bool True if the signal was queued, false if the task's queue is full
+     */
+    bool post(event_task& task, event_task::signal sig) {
+        DISABLE_INTERRUPTS();
+        bool was_idle = (task.m_count == 0);
+        bool queued = task.push(sig);
+        ENABLE_INTERRUPTS();
+
+        // The interrupt is already pending or running if the task had signals queued
+        if ( queued && was_idle ) {
+            m_pend(task.get_priority());
+        }
+        return queued;
+    }
+
+    /**
+     * \brief Run the task at a priority level until its queue is empty. Called from the interrupt tied to the level.
+     *        Interrupts are enabled while the handler runs so that higher priority tasks can preempt it.
+     * 
+     * \param priority The priority level
+     */
+    void dispatch(uint32_t priority) {
+        if ( (priority >= Levels) || (m_tasks[priority] == nullptr) ) {
+            return;
+        }
+        auto* task = m_tasks[priority];
+        event_task::signal sig;
+
+        DISABLE_INTERRUPTS();
+        auto preempted_priority = m_active_priority;
+        m_active_priority = priority;
+        while ( task->pop(sig) ) {
+            ENABLE_INTERRUPTS();
+            task->m_handler(*task, sig);
+            DISABLE_INTERRUPTS();
+        }
+        m_active_priority = preempted_priority;
+        ENABLE_INTERRUPTS();
+    }
+
+    /**
+     * \brief Get the priority of the event task that is running
+     * 
+     * \retval uint32_t Priority of the running task, or idle_priority if none is running
+     */
+    uint32_t get_active_priority() const {
+        return m_active_priority;
+    }
+
+  private:
+    std::array<event_task*, Levels> m_tasks = {};
+    pend_interrupt m_pend;
+    uint32_t m_active_priority = idle_priority;
+};
+
+};  // namespace os
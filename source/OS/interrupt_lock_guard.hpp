@@ -4,6 +4,7 @@
 #pragma once
 
 #include "device_port.hpp"
+#include <cstdint>
 
 namespace os
 {
@@ -27,4 +28,31 @@ struct interrupt_guard {
     }
 };
 
+/**
+ * \brief RAII guard that disables interrupts and restores the previous interrupt state on exit, rather than always
+ *        re-enabling interrupts like interrupt_guard. Used by the calls that may run from an interrupt handler or from
+ *        inside another critical section.
+ */
+class interrupt_restore_guard {
+  public:
+    /**
+     * \brief Construct a new interrupt restore guard object, which saves the interrupt state and disables interrupts
+     */
+    interrupt_restore_guard()
+        : m_state(port::save_and_disable_interrupts()) { }
+
+    /**
+     * \brief Destroy the interrupt restore guard object, which restores the saved interrupt state
+     */
+    ~interrupt_restore_guard() {
+        port::restore_interrupts(m_state);
+    }
+
+    interrupt_restore_guard(const interrupt_restore_guard&) = delete;
+    interrupt_restore_guard& operator=(const interrupt_restore_guard&) = delete;
+
+  private:
+    uint32_t m_state;
+};
+
 };  // namespace os
\ No newline at end of file
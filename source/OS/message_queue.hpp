@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "blocking_wait.hpp"
+#include "device_port.hpp"
+#include "interrupt_lock_guard.hpp"
+#include "ring_buffer.hpp"
+#include "scheduler.hpp"
+#include "wait_queue.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace os
+{
+
+/**
+ * \brief Fixed capacity queue of typed messages between threads, and from interrupts to threads. Sending and receiving
+ *        each take a single critical section, and the queue tracks its own waiting senders and receivers, so no extra
+ *        semaphore is needed. Messages live in a ring_buffer, so emplace builds a message straight in its slot and
+ *        receive_into moves it straight out into the caller's object.
+ *
+ *        The try_ calls never block and restore the caller's interrupt state on exit, so they are safe to call from
+ *        interrupts, including handlers that run with interrupts disabled.
+ *
+ *        Threads wait with the highest priority thread first. A woken thread checks the queue again once it runs, as
+ *        a thread that did not block may have used the message or slot first, and waits again for the rest of its
+ *        timeout if so.
+ *
+ * \tparam T Message type
+ * \tparam Capacity Max number of queued messages
+ */
+template <typename T, std::size_t Capacity>
+class message_queue {
+  public:
+    //!< Wait until the operation can complete, however long that takes
+    static constexpr uint32_t wait_forever = scheduler_impl::wait_forever;
+
+    /**
+     * \brief Create an empty message queue managed by the os scheduler
+     */
+    message_queue()
+        : message_queue(scheduler::get()) { }
+
+    /**
+     * \brief Create an empty message queue managed by a specific scheduler
+     *
+     * \param scheduler The scheduler that runs the threads using the queue
+     */
+    explicit message_queue(scheduler_impl& scheduler)
+        : m_scheduler(&scheduler)
+        , m_senders(wait_queue::order::priority)
+        , m_receivers(wait_queue::order::priority) { }
+
+    // Message queue cannot be copied or moved as waiting threads link to its wait queues
+    message_queue(const message_queue&) = delete;
+    message_queue& operator=(const message_queue&) = delete;
+    message_queue(message_queue&&) = delete;
+    message_queue& operator=(message_queue&&) = delete;
+
+    /**
+     * \brief Send a copy of a message, waiting for a free slot if the queue is full
+     *
+     * \param message The message
+     * \param timeout Max ticks to wait for a free slot, or wait_forever
+     * \retval bool True if sent, false if the wait timed out
+     */
+    bool send(const T& message, uint32_t timeout = wait_forever) {
+        return emplace_for(timeout, message);
+    }
+
+    /**
+     * \brief Send a message by moving it, waiting for a free slot if the queue is full
+     *
+     * \param message The message
+     * \param timeout Max ticks to wait for a free slot, or wait_forever
+     * \retval bool True if sent, false if the wait timed out
+     */
+    bool send(T&& message, uint32_t timeout = wait_forever) {
+        return emplace_for(timeout, std::move(message));
+    }
+
+    /**
+     * \brief Send a copy of a message if the queue has a free slot. Never blocks, so it is safe to call from an
+     *        interrupt.
+     *
+     * \param message The message
+     * \retval bool True if sent, false if the queue is full
+     */
+    bool try_send(const T& message) {
+        return try_emplace(message);
+    }
+
+    /**
+     * \brief Send a message by moving it if the queue has a free slot. Never blocks, so it is safe to call from an
+     *        interrupt.
+     *
+     * \param message The message
+     * \retval bool True if sent, false if the queue is full
+     */
+    bool try_send(T&& message) {
+        return try_emplace(std::move(message));
+    }
+
+    /**
+     * \brief Construct a message in place in the queue, waiting for a free slot for as long as it takes
+     *
+     * \param args Arguments forwarded to the constructor of T
+     */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        (void)emplace_for(wait_forever, std::forward<Args>(args)...);
+    }
+
+    /**
+     * \brief Construct a message in place in the queue if it has a free slot. Never blocks, so it is safe to call
+     *        from an interrupt.
+     *
+     * \param args Arguments forwarded to the constructor of T
+     * \retval bool True if sent, false if the queue is full
+     */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        os::interrupt_restore_guard guard;
+        if ( m_messages.full() ) {
+            return false;
+        }
+        push_message(std::forward<Args>(args)...);
+        return true;
+    }
+
+    /**
+     * \brief Construct a message in place in the queue, waiting for a free slot if the queue is full
+     *
+     * \param timeout Max ticks to wait for a free slot, or wait_forever
+     * \param args Arguments forwarded to the constructor of T
+     * \retval bool True if sent, false if the wait timed out
+     */
+    template <typename... Args>
+    bool emplace_for(uint32_t timeout, Args&&... args) {
+        DISABLE_INTERRUPTS();
+        if ( !wait_while_full(timeout) ) {
+            ENABLE_INTERRUPTS();
+            return false;
+        }
+        push_message(std::forward<Args>(args)...);
+        ENABLE_INTERRUPTS();
+        return true;
+    }
+
+    /**
+     * \brief Receive the oldest message, waiting for one if the queue is empty
+     *
+     * \param timeout Max ticks to wait for a message, or wait_forever
+     * \retval std::optional<T> The message, or nullopt if the wait timed out
+     */
+    std::optional<T> receive(uint32_t timeout = wait_forever) {
+        DISABLE_INTERRUPTS();
+        if ( !wait_while_empty(timeout) ) {
+            ENABLE_INTERRUPTS();
+            return {};
+        }
+        auto message = m_messages.pop_back();
+        message_taken();
+        ENABLE_INTERRUPTS();
+        return message;
+    }
+
+    /**
+     * \brief Receive the oldest message if there is one. Never blocks, so it is safe to call from an interrupt.
+     *
+     * \retval std::optional<T> The message, or nullopt if the queue is empty
+     */
+    std::optional<T> try_receive() {
+        os::interrupt_restore_guard guard;
+        if ( m_messages.empty() ) {
+            return {};
+        }
+        auto message = m_messages.pop_back();
+        message_taken();
+        return message;
+    }
+
+    /**
+     * \brief Receive the oldest message by moving it straight from its slot into an existing object, waiting for one if
+     *        the queue is empty
+     *
+     * \param destination Object the message is moved into
+     * \param timeout Max ticks to wait for a message, or wait_forever
+     * \retval bool True if a message was received, false if the wait timed out
+     */
+    bool receive_into(T& destination, uint32_t timeout = wait_forever) {
+        DISABLE_INTERRUPTS();
+        if ( !wait_while_empty(timeout) ) {
+            ENABLE_INTERRUPTS();
+            return false;
+        }
+        take_message_into(destination);
+        ENABLE_INTERRUPTS();
+        return true;
+    }
+
+    /**
+     * \brief Receive the oldest message into an existing object if there is one. Never blocks, so it is safe to call
+     *        from an interrupt.
+     *
+     * \param destination Object the message is moved into
+     * \retval bool True if a message was received, false if the queue is empty
+     */
+    bool try_receive_into(T& destination) {
+        os::interrupt_restore_guard guard;
+        if ( m_messages.empty() ) {
+            return false;
+        }
+        take_message_into(destination);
+        return true;
+    }
+
+    /**
+     * \brief Get the number of queued messages
+     *
+     * \retval std::size_t Number of messages
+     */
+    std::size_t size() const {
+        return m_messages.size();
+    }
+
+    /**
+     * \brief Checks if no messages are queued
+     *
+     * \retval bool True if empty
+     */
+    bool empty() const {
+        return m_messages.empty();
+    }
+
+    /**
+     * \brief Checks if every slot holds a message
+     *
+     * \retval bool True if full
+     */
+    bool full() const {
+        return m_messages.full();
+    }
+
+  private:
+    bool wait_while_full(uint32_t timeout) {
+        return wait_while(*m_scheduler, m_senders, [this]() { return m_messages.full(); }, timeout);
+    }
+
+    bool wait_while_empty(uint32_t timeout) {
+        return wait_while(*m_scheduler, m_receivers, [this]() { return m_messages.empty(); }, timeout);
+    }
+
+    /**
+     * \brief Construct a message in the queue and wake the highest priority waiting receiver. Must be called with
+     *        interrupts disabled and a free slot.
+     */
+    template <typename... Args>
+    void push_message(Args&&... args) {
+        m_messages.emplace_back(std::forward<Args>(args)...);
+        m_scheduler->wake_one(m_receivers);
+    }
+
+    /**
+     * \brief Move the oldest message straight out of its slot and free the slot. Must be called with interrupts
+     *        disabled and at least one message queued.
+     *
+     * \param destination Object the message is moved into
+     */
+    void take_message_into(T& destination) {
+        destination = std::move(m_messages.readable_regions().first.front());
+        m_messages.commit_read(1);
+        message_taken();
+    }
+
+    /**
+     * \brief Wake the highest priority waiting sender now that a slot is free. Must be called with interrupts disabled.
+     */
+    void message_taken() {
+        m_scheduler->wake_one(m_senders);
+    }
+
+    scheduler_impl* m_scheduler;
+    wait_queue m_senders;
+    wait_queue m_receivers;
+    ring_buffer<T, Capacity> m_messages;
+};
+
+};  // namespace os
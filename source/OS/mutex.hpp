@@ -3,18 +3,25 @@
 
 #pragma once
 
+#include "coroutine_wait_list.hpp"
 #include "device_port.hpp"
 #include "interrupt_lock_guard.hpp"
-#include "ring_buffer.hpp"
+#include "owned_lock.hpp"
 #include "scheduler.hpp"
 #include "task_control_block.hpp"
 #include <algorithm>
+#include <coroutine>
 #include <cstdint>
 #include <type_traits>
 
 namespace os
 {
 
+/**
+ * \brief Mutex with priority inheritance. While a thread waits on the mutex, the owner runs at the priority of the
+ *        highest priority waiting thread so that a lower priority owner cannot hold up a higher priority thread for an
+ *        unbounded time.
+ */
 class mutex {
   public:
     /**
@@ -22,37 +29,35 @@ class mutex {
      * \todo: constexpr?
      */
     mutex()
-        : m_scheduler(&scheduler::get())
-        , m_locked(false) { }
+        : mutex(scheduler::get()) { }
+
+    /**
+     * \brief Create a new mutex managed by a specific scheduler
+     * 
+     * \param scheduler The scheduler that runs the threads using the mutex
+     */
+    explicit mutex(scheduler_impl& scheduler)
+        : m_scheduler(&scheduler) { }
 
     // Mutex is not copyable
     mutex(const mutex&) = delete;
     mutex& operator=(const mutex&) = delete;
 
-    // Mutex can be moved
-    mutex(mutex&&) = default;
-    mutex& operator=(mutex&&) = default;
+    // Mutex cannot be moved as waiting threads link to its wait queue
+    mutex(mutex&&) = delete;
+    mutex& operator=(mutex&&) = delete;
 
     // Destroys the mutex, undefined behavior if any thread still owns the lock
     ~mutex() = default;
 
     /**
-     * \brief Attempt to acquire the lock
+     * \brief Attempt to acquire the lock. Threads waiting on the lock get it in priority order
      */
     void lock() {
-        DISABLE_INTERRUPTS();
-        if ( !m_locked ) {
-            m_locked = true;
-            ENABLE_INTERRUPTS();            
-        } else {
-            // Suspend the calling thread on the mutex
-            m_suspended_threads.push_back(m_scheduler->get_active_tcb_ptr());
-            ENABLE_INTERRUPTS();
-            m_scheduler->suspend_thread();
-            // Thread has now worken up and can now take the lock
-            DISABLE_INTERRUPTS();
-            m_locked = true;
-            ENABLE_INTERRUPTS();            
+        os::interrupt_guard guard;
+        if ( !m_scheduler->try_take_lock(m_lock) ) {
+            // Wait for unlock to hand the lock to this thread. The switch happens once interrupts are re-enabled
+            m_scheduler->block_on_lock(m_lock);
         }
     }
 
@@ -63,29 +68,153 @@ class mutex {
      */
     bool try_lock() {
         os::interrupt_guard guard;
-        if ( !m_locked ) {
-            m_locked = true;
+        return m_scheduler->try_take_lock(m_lock);
+    }
+
+    /**
+     * \brief Try to lock the mutex, waiting for up to a number of ticks if it is already locked. The waiting thread
+     *        is parked on the lock and on the sleep list, so it is woken exactly once by whichever happens first.
+     * 
+     * \param rel_time_ms Max time to wait in ms
+     * \return bool True if successfully locked
+     */
+    [[nodiscard]] bool try_lock_for(uint32_t rel_time_ms) {
+        DISABLE_INTERRUPTS();
+        if ( m_scheduler->try_take_lock(m_lock) ) {
+            ENABLE_INTERRUPTS();
             return true;
         }
-        return false;
+        m_scheduler->block_on_lock(m_lock, rel_time_ms);
+        ENABLE_INTERRUPTS();
+
+        // Running again, either with the lock handed over by unlock or after the timeout
+        return m_scheduler->get_active_tcb_ptr()->wait_status == wait_result::signaled;
+    }
+
+    /**
+     * \brief Try to lock the mutex, waiting until an absolute system tick if it is already locked
+     * 
+     * \param timeout_tick System tick to give up at
+     * \return bool True if successfully locked
+     */
+    [[nodiscard]] bool try_lock_until(uint32_t timeout_tick) {
+        uint32_t now = m_scheduler->get_elapsed_ticks();
+        return try_lock_for(sleep_list::tick_reached(now, timeout_tick) ? 0 : timeout_tick - now);
     }
 
     /**
-     * \brief Unlock the mutex and wake up any threads pending on the lock     
+     * \brief Unlock the mutex and wake up any threads pending on the lock. The caller drops any priority it inherited
+     *        through this mutex, and a woken thread with a higher priority than the caller preempts it immediately.
+     *        Unlocking a mutex that the caller does not own does nothing.
      */
     void unlock() {
         os::interrupt_guard guard;
-        m_locked = false;        
-        if ( auto pending = m_suspended_threads.pop_back() ) {
-            auto* tcb = pending.value();
-            tcb->thread_ptr->set_status(thread::status::pending);
+        // Ownership passes straight to the next waiter so the mutex stays locked
+        if ( !m_scheduler->release_lock(m_lock) ) {
+            return;
+        }
+
+        // With no threads waiting, hand the mutex to the first waiting coroutine on behalf of its executor thread
+        if ( m_lock.owner == nullptr ) {
+            if ( auto* waiter = m_coroutine_waiters.pop_front() ) {
+                m_scheduler->try_take_lock(m_lock, waiter->thread);
+                waiter->wake_locked(*waiter);
+            }
+        }
+    }
+
+    /**
+     * \brief Awaitable that locks the mutex from a coroutine, suspending the coroutine instead of its thread while the
+     *        mutex is locked. The lock is owned by the thread that runs the coroutine's executor, so the coroutine must
+     *        unlock it from the same executor. Waiting coroutines do not lend their priority to the owner, and they
+     *        get the mutex only once no threads are waiting for it.
+     */
+    class lock_awaiter {
+      public:
+        explicit lock_awaiter(mutex& mutex)
+            : m_mutex(mutex) { }
+
+        bool await_ready() {
+            return m_mutex.try_lock();
         }
+
+        template <typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> handle) {
+            handle.promise().prepare_waiter(m_waiter, handle);
+            os::interrupt_guard guard;
+            if ( m_mutex.m_scheduler->try_take_lock(m_mutex.m_lock, m_waiter.thread) ) {
+                return false;
+            }
+            m_mutex.m_coroutine_waiters.push_back(m_waiter);
+            return true;
+        }
+
+        void await_resume() { }
+
+      private:
+        mutex& m_mutex;
+        coroutine_waiter m_waiter;
+    };
+
+    /**
+     * \brief Lock the mutex from a coroutine with co_await
+     * 
+     * \return lock_awaiter Awaitable that completes once the mutex is locked
+     */
+    [[nodiscard]] lock_awaiter lock_async() {
+        return lock_awaiter(*this);
     }
 
-  private:
+    /**
+     * \brief Get the thread that owns the mutex
+     * 
+     * \return task_control_block* The owning thread or nullptr if unlocked
+     */
+    task_control_block* owner() const {
+        return m_lock.owner;
+    }
+
+  protected:
     scheduler_impl* m_scheduler;
-    bool m_locked;
-    ring_buffer<task_control_block*, MAX_THREAD_COUNT> m_suspended_threads;
+    owned_lock m_lock;
+    coroutine_wait_list m_coroutine_waiters;
+};
+
+/**
+ * \brief Mutex using the immediate priority ceiling protocol. Locking the mutex raises the caller straight to the
+ *        ceiling priority, which must be at least as high as the priority of every thread that uses the mutex. No
+ *        thread that shares the mutex can then preempt the owner, so the lock is never contended unless the owner
+ *        blocks while holding it, and nested ceiling mutexes cannot deadlock.
+ */
+class ceiling_mutex : public mutex {
+  public:
+    /**
+     * \brief Create a new ceiling mutex
+     * 
+     * \param ceiling Highest priority of any thread that locks the mutex
+     */
+    explicit ceiling_mutex(uint32_t ceiling)
+        : ceiling_mutex(scheduler::get(), ceiling) { }
+
+    /**
+     * \brief Create a new ceiling mutex managed by a specific scheduler
+     * 
+     * \param scheduler The scheduler that runs the threads using the mutex
+     * \param ceiling Highest priority of any thread that locks the mutex
+     */
+    ceiling_mutex(scheduler_impl& scheduler, uint32_t ceiling)
+        : mutex(scheduler) {
+        m_lock.ceiling = ceiling;
+    }
+
+    /**
+     * \brief Get the ceiling priority of the mutex
+     * 
+     * \return uint32_t The ceiling priority
+     */
+    uint32_t ceiling() const {
+        return m_lock.ceiling;
+    }
 };
 
 };  // namespace os
@@ -18,7 +18,8 @@ namespace kernel
 void setup(void) {
     DISABLE_INTERRUPTS();
 
-    // Initialize the task pointers to initialize the kernel
+    // Pick the highest priority thread to run first and initialize the task pointers to initialize the kernel
+    scheduler::get().select_initial_task();
     system_active_task = scheduler::get_active_task_control_block();
     system_pending_task = scheduler::get_pending_task_control_block();
 
@@ -32,7 +33,9 @@ void setup(void) {
 }
 
 /**
- * \brief pick up the first task control block pointer
+ * \brief pick up the first task control block pointer. Threads run on the process stack (PSP) while
+ *        main and all exception handlers stay on the main stack (MSP), so thread stacks never have to
+ *        hold interrupt frames beyond the basic exception entry frame.
  */
 // clang-format off
 __attribute__((naked))  void enter(void) {
@@ -42,12 +45,13 @@ __attribute__((naked))  void enter(void) {
         "CPSID      I                        \n" // Disable interrupts
         "LDR        R0, =system_active_task  \n" // Load the active task pointer into r0
         "LDR        R1, [R0]                 \n" // Load the stack pointer from the contents of task into R1
-        "LDR        R4, [R1]                 \n" // Copy the saved stack pointer into R4
-        "MOV        SP, R4                   \n" // Update the stack pointer
-        "POP        {R4-R11}                 \n" // Pop R4-R11 off the stack
-        "VPOP       {D0-D15}                 \n" //             
-        "POP        {R0}                     \n" //
-        "VMSR       fpscr, r0                \n" //       
+        "LDR        R0, [R1]                 \n" // Copy the saved stack pointer into R0
+        "LDMIA      R0!, {R4-R11}            \n" // Pop R4-R11 off the thread stack
+        "ADD        R0, R0, #4               \n" // Skip the EXC_RETURN value, new threads always have a short frame
+        "MSR        PSP, R0                  \n" // Point the process stack at the remaining exception frame
+        "MOV        R0, #2                   \n" // Select PSP in thread mode and clear CONTROL.FPCA so any FPU
+        "MSR        CONTROL, R0              \n" // use in main is not carried into the first thread
+        "ISB                                 \n" // Flush the pipeline so the stack switch takes effect
         "POP        {R0, R1, R2, R3, R12}    \n" // Pop R0-R3 and R12 off the stack
         "ADD        SP,SP,#4                 \n" // Skip over the saved LR as it is invalid on startup
         "POP        {R4}                     \n" // Grab the task function pointer
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "task_control_block.hpp"
+#include "wait_queue.hpp"
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief Kernel state for a lock that has a single owner. The scheduler uses it to boost the owner to the priority of
+ *        the highest priority thread waiting on the lock (priority inheritance), and to the lock's ceiling priority if
+ *        it has one (immediate priority ceiling). Each thread keeps a list of the locks it holds so that its priority
+ *        can be recomputed when a lock is released, even with nested locks.
+ */
+struct owned_lock {
+    //!< Ceiling value for locks that only use priority inheritance
+    static constexpr uint32_t no_ceiling = UINT32_MAX;
+
+    wait_queue waiters{wait_queue::order::priority};
+    task_control_block* owner = nullptr;
+    owned_lock* next_held = nullptr;
+    uint32_t ceiling = no_ceiling;
+};
+
+};  // namespace os
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief Bitmap of priority levels that have at least one ready thread. Priority zero is the highest priority and maps
+ *        to the most significant bit of the first word so that the highest ready priority can be resolved with a single
+ *        count leading zeros (CLZ) instruction. Configurations with more than 32 levels use a second level group word where
+ *        each bit flags a non-empty 32 bit word, so the lookup is still two CLZ instructions regardless of thread count.
+ *
+ * \tparam Levels Number of priority levels supported by the bitmap
+ */
+template <std::size_t Levels>
+class priority_bitmap {
+    static constexpr std::size_t bits_per_word = 32;
+    static constexpr std::size_t word_count = (Levels + bits_per_word - 1) / bits_per_word;
+    static constexpr uint32_t most_significant_bit = 0x80000000ul;
+
+    static_assert(Levels > 0, "priority_bitmap must have at least one priority level");
+    static_assert(word_count <= bits_per_word, "priority_bitmap supports at most 1024 priority levels");
+
+  public:
+    /**
+     * \brief Flag a priority level as having a ready thread
+     *
+     * \param priority The priority level
+     */
+    void set(std::size_t priority) {
+        const auto word = priority / bits_per_word;
+        m_words[word] |= most_significant_bit >> (priority % bits_per_word);
+        if constexpr ( word_count > 1 ) {
+            m_groups |= most_significant_bit >> word;
+        }
+    }
+
+    /**
+     * \brief Clear the flag for a priority level
+     *
+     * \param priority The priority level
+     */
+    void clear(std::size_t priority) {
+        const auto word = priority / bits_per_word;
+        m_words[word] &= ~(most_significant_bit >> (priority % bits_per_word));
+        if constexpr ( word_count > 1 ) {
+            if ( m_words[word] == 0 ) {
+                m_groups &= ~(most_significant_bit >> word);
+            }
+        }
+    }
+
+    /**
+     * \brief Check if a priority level is flagged
+     *
+     * \param priority The priority level
+     * \retval bool True if the level is set
+     */
+    bool test(std::size_t priority) const {
+        return (m_words[priority / bits_per_word] & (most_significant_bit >> (priority % bits_per_word))) != 0;
+    }
+
+    /**
+     * \brief Check if no priority levels are flagged
+     *
+     * \retval bool True if the bitmap is empty
+     */
+    bool empty() const {
+        if constexpr ( word_count > 1 ) {
+            return m_groups == 0;
+        } else {
+            return m_words[0] == 0;
+        }
+    }
+
+    /**
+     * \brief Get the highest flagged priority level (lowest number)
+     *
+     * \retval std::size_t The highest priority, or Levels if the bitmap is empty
+     */
+    std::size_t highest() const {
+        if ( empty() ) {
+            return Levels;
+        }
+        if constexpr ( word_count > 1 ) {
+            const auto word = static_cast<std::size_t>(std::countl_zero(m_groups));
+            return word * bits_per_word + static_cast<std::size_t>(std::countl_zero(m_words[word]));
+        } else {
+            return static_cast<std::size_t>(std::countl_zero(m_words[0]));
+        }
+    }
+
+  private:
+    uint32_t m_groups = 0;
+    std::array<uint32_t, word_count> m_words = {};
+};
+
+};  // namespace os
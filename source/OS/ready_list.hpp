@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "priority_bitmap.hpp"
+#include "task_control_block.hpp"
+#include "task_list.hpp"
+#include <array>
+#include <cstddef>
+
+namespace os
+{
+
+/**
+ * \brief Set of threads that are ready to run, organized as one FIFO list per priority level plus a bitmap of the
+ *        non-empty levels. Inserting, removing, and finding the highest priority ready thread are all constant time.
+ *
+ * \tparam PriorityLevels Number of priority levels. Priority zero is the highest priority
+ */
+template <std::size_t PriorityLevels>
+class ready_list {
+  public:
+    using list_type = task_list<&task_control_block::ready_link>;
+
+    /**
+     * \brief Add a thread to the back of the list for its priority level
+     *
+     * \param tcb The thread to add
+     */
+    void insert(task_control_block* tcb) {
+        m_lists[tcb->priority].push_back(tcb);
+        m_bitmap.set(tcb->priority);
+    }
+
+    /**
+     * \brief Add a thread to the front of the list for its priority level so it runs next at that level
+     *
+     * \param tcb The thread to add
+     */
+    void insert_front(task_control_block* tcb) {
+        m_lists[tcb->priority].push_front(tcb);
+        m_bitmap.set(tcb->priority);
+    }
+
+    /**
+     * \brief Remove a thread from the ready list
+     *
+     * \param tcb The thread to remove, which must currently be in the list
+     */
+    void remove(task_control_block* tcb) {
+        auto& list = m_lists[tcb->priority];
+        list.remove(tcb);
+        if ( list.empty() ) {
+            m_bitmap.clear(tcb->priority);
+        }
+    }
+
+    /**
+     * \brief Get the thread that should run next, which is the first thread at the highest ready priority level
+     *
+     * \retval task_control_block* The next thread or nullptr if no threads are ready
+     */
+    task_control_block* top() const {
+        if ( m_bitmap.empty() ) {
+            return nullptr;
+        }
+        return m_lists[m_bitmap.highest()].front();
+    }
+
+    /**
+     * \brief Check if there are no ready threads
+     *
+     * \retval bool True if empty
+     */
+    bool empty() const {
+        return m_bitmap.empty();
+    }
+
+  private:
+    priority_bitmap<PriorityLevels> m_bitmap;
+    std::array<list_type, PriorityLevels> m_lists;
+};
+
+};  // namespace os
@@ -4,8 +4,14 @@
 #pragma once
 
 
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
 #include <optional>
+#include <span>
 #include <type_traits>
+#include <utility>
 
 namespace detail
 {
@@ -159,7 +165,10 @@ struct reverse_iterator {
 };  // namespace detail
 
 /**
- * \brief template class for a STL-like re-usable ring buffer with no dynamic allocation
+ * \brief template class for a STL-like re-usable ring buffer with no dynamic allocation. Items live in raw aligned
+ *        storage and are only constructed when pushed and destroyed when popped, so item types do not need to be
+ *        default constructible or copyable. When the capacity is a power of two the indices wrap with a mask instead
+ *        of a compare and branch.
  * 
  * \tparam T parameter type
  */
@@ -175,10 +184,16 @@ class ring_buffer {
      * 
      */
     explicit ring_buffer()
-        : m_buffer()
-        , m_head(0)
+        : m_head(0)
         , m_tail(0) { }
 
+    /**
+     * \brief Destroy the Ring Buffer object and any items left in it
+     */
+    ~ring_buffer() {
+        flush();
+    }
+
     //!< Delete copies and moves
     ring_buffer(const ring_buffer& other) = delete;
     ring_buffer(ring_buffer&& other) = delete;
@@ -193,15 +208,61 @@ class ring_buffer {
      * \param data Universal reference to the data to put into the buffer
      */
     template <typename ValueType>
+        requires(!std::is_convertible_v<ValueType &&, std::span<const T>>)
     void push_back(ValueType&& data) {
-        static_assert(std::is_same_v<std::remove_reference_t<ValueType>, T>, "Invalid type for ring_buffer");
+        static_assert(std::is_same_v<std::remove_cvref_t<ValueType>, T>, "Invalid type for ring_buffer");
+        emplace_back(std::forward<ValueType>(data));
+    }
+
+    /**
+     * \brief Construct a value in place at the back of the buffer. If the buffer is full the oldest value is destroyed
+     *        to make room.
+     * 
+     * @tparam Args Types of the constructor arguments
+     * \param args Arguments forwarded to the constructor of T
+     * \return T& Reference to the new value
+     */
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
         if ( full() ) {
+            std::destroy_at(slot(m_tail));
             increment(m_tail);
         } else {
             ++m_size;
         }
-        m_buffer[m_head] = data;
+        auto* value = std::construct_at(slot(m_head), std::forward<Args>(args)...);
         increment(m_head);
+        return *value;
+    }
+
+    /**
+     * \brief Push a block of values to the back of the buffer with at most two copies. Like pushing the values one at a
+     *        time, the oldest values are overwritten once the buffer is full.
+     * 
+     * \param data The values to push, oldest first
+     */
+    void push_back(std::span<const T> data) {
+        if constexpr ( !std::is_trivially_copyable_v<T> ) {
+            for ( const auto& value : data ) {
+                emplace_back(value);
+            }
+        } else if ( data.size() >= MaxCapacity ) {
+            // Only the newest values fit, so the buffer starts over with them
+            std::copy(data.end() - MaxCapacity, data.end(), slot(0));
+            m_head = 0;
+            m_tail = 0;
+            m_size = MaxCapacity;
+        } else {
+            auto first = std::min(data.size(), MaxCapacity - m_head);
+            std::copy(data.begin(), data.begin() + first, slot(m_head));
+            std::copy(data.begin() + first, data.end(), slot(0));
+            m_head = wrap(m_head + data.size());
+            m_size += data.size();
+            if ( m_size > MaxCapacity ) {
+                m_tail = m_head;
+                m_size = MaxCapacity;
+            }
+        }
     }
 
     /**
@@ -212,14 +273,29 @@ class ring_buffer {
      */
     template <typename ValueType>
     void push_front(ValueType&& data) {
-        static_assert(std::is_same_v<std::remove_reference_t<ValueType>, T>, "Invalid type for ring_buffer");
+        static_assert(std::is_same_v<std::remove_cvref_t<ValueType>, T>, "Invalid type for ring_buffer");
+        emplace_front(std::forward<ValueType>(data));
+    }
+
+    /**
+     * \brief Construct a value in place at the front of the buffer. If the buffer is full the newest value is destroyed
+     *        to make room.
+     * 
+     * @tparam Args Types of the constructor arguments
+     * \param args Arguments forwarded to the constructor of T
+     * \return T& Reference to the new value
+     */
+    template <typename... Args>
+    T& emplace_front(Args&&... args) {
         decrement(m_tail);
         if ( full() ) {
-            increment(m_head);
+            // The slot before the oldest value holds the newest value
+            std::destroy_at(slot(m_tail));
+            decrement(m_head);
         } else {
             ++m_size;
         }
-        m_buffer[m_tail] = data;                
+        return *std::construct_at(slot(m_tail), std::forward<Args>(args)...);
     }
 
     /**
@@ -231,11 +307,11 @@ class ring_buffer {
         if ( empty() ) {
             return {};
         }
-        auto temp = m_head;
-        decrement(temp);
-        auto value = m_buffer[temp];
+        decrement(m_head);
+        std::optional<T> value{std::move(*slot(m_head))};
+        std::destroy_at(slot(m_head));
         --m_size;
-        return value;                
+        return value;
     }
 
     /**
@@ -247,13 +323,85 @@ class ring_buffer {
         if ( empty() ) {
             return {};
         }
-
-        auto value = m_buffer[m_tail];
-        increment(m_tail);        
+        std::optional<T> value{std::move(*slot(m_tail))};
+        std::destroy_at(slot(m_tail));
+        increment(m_tail);
         --m_size;
         return value;
     }
 
+    /**
+     * \brief Pop a block of the oldest values from the back of the buffer with at most two copies, in the same order
+     *        as popping them one at a time with pop_back
+     * 
+     * \param destination Where to copy the values to
+     * \return std::size_t Number of values popped, which is less than the destination size if the buffer runs out
+     */
+    std::size_t pop_back(std::span<T> destination) {
+        auto [first, second] = readable_regions();
+        auto count = std::min(destination.size(), m_size);
+        auto from_first = std::min(count, first.size());
+        std::move(first.begin(), first.begin() + from_first, destination.begin());
+        std::move(second.begin(), second.begin() + (count - from_first), destination.begin() + from_first);
+        commit_read(count);
+        return count;
+    }
+
+    /**
+     * \brief Get the values in the buffer as up to two contiguous regions of the underlying storage, oldest first, for
+     *        example to hand straight to a DMA engine. The second region is empty unless the values wrap around the
+     *        end of the storage. Release the values with commit_read once they have been used.
+     * 
+     * \return std::pair<std::span<T>, std::span<T>> The regions in the order that pop_back returns their values
+     */
+    std::pair<std::span<T>, std::span<T>> readable_regions() {
+        auto first = std::min(m_size, MaxCapacity - m_tail);
+        return {std::span<T>(slot(m_tail), first), std::span<T>(slot(0), m_size - first)};
+    }
+
+    /**
+     * \brief Get the free space after the newest value as up to two contiguous regions of the underlying storage, for
+     *        example for a DMA engine to receive into. The second region is empty unless the free space wraps around
+     *        the end of the storage. Add the written values to the buffer with commit_write. Only available for
+     *        trivially copyable types, as the free slots hold no constructed values.
+     * 
+     * \return std::pair<std::span<T>, std::span<T>> The regions in the order that values are pushed to the back
+     */
+    std::pair<std::span<T>, std::span<T>> writable_regions()
+        requires std::is_trivially_copyable_v<T>
+    {
+        auto free = MaxCapacity - m_size;
+        auto first = std::min(free, MaxCapacity - m_head);
+        return {std::span<T>(slot(m_head), first), std::span<T>(slot(0), free - first)};
+    }
+
+    /**
+     * \brief Release values that were read through readable_regions, destroying them
+     * 
+     * \param count Number of the oldest values to release, at most the size of the buffer
+     */
+    void commit_read(std::size_t count) {
+        if constexpr ( !std::is_trivially_destructible_v<T> ) {
+            for ( std::size_t i = 0; i < count; i++ ) {
+                std::destroy_at(slot(wrap(m_tail + i)));
+            }
+        }
+        m_tail = wrap(m_tail + count);
+        m_size -= count;
+    }
+
+    /**
+     * \brief Add values that were written through writable_regions to the back of the buffer
+     * 
+     * \param count Number of values written, at most the free space in the buffer
+     */
+    void commit_write(std::size_t count)
+        requires std::is_trivially_copyable_v<T>
+    {
+        m_head = wrap(m_head + count);
+        m_size += count;
+    }
+
     //!< Iterators
     // clang-format off
     using forward_iterator       = detail::iterator<T, MaxCapacity, false>;
@@ -268,7 +416,7 @@ class ring_buffer {
      * \return forward_iterator 
      */
     forward_iterator begin() {
-        return forward_iterator(&m_buffer[m_tail], m_buffer);
+        return forward_iterator(slot(m_tail), slot(0));
     }
 
     /**
@@ -277,7 +425,7 @@ class ring_buffer {
      * \return const_forward_iterator 
      */
     const_forward_iterator cbegin() {
-        return const_forward_iterator(&m_buffer[m_tail], m_buffer);
+        return const_forward_iterator(slot(m_tail), slot(0));
     }
 
     /**
@@ -287,11 +435,11 @@ class ring_buffer {
      */
     forward_iterator end() {
         if ( full() ) {
-            return forward_iterator(nullptr, m_buffer);
+            return forward_iterator(nullptr, slot(0));
         }
         auto temp = m_head;
         decrement(temp);
-        return forward_iterator(&m_buffer[temp], m_buffer);
+        return forward_iterator(slot(temp), slot(0));
     }
 
     /**
@@ -301,11 +449,11 @@ class ring_buffer {
      */
     const_forward_iterator cend() {
         if ( full() ) {
-            return const_forward_iterator(nullptr, m_buffer);
+            return const_forward_iterator(nullptr, slot(0));
         }
         auto temp = m_head;
         decrement(temp);
-        return const_forward_iterator(&m_buffer[temp], m_buffer);
+        return const_forward_iterator(slot(temp), slot(0));
     }
 
     //!< Reverse Iterators
@@ -317,7 +465,7 @@ class ring_buffer {
     reverse_iterator rbegin() {
         auto temp = m_head;
         decrement(temp);
-        return reverse_iterator(&m_buffer[temp], m_buffer);
+        return reverse_iterator(slot(temp), slot(0));
     }
 
     /**
@@ -328,7 +476,7 @@ class ring_buffer {
     const_reverse_iterator crbegin() {
         auto temp = m_head;
         decrement(temp);
-        return const_reverse_iterator(&m_buffer[temp], m_buffer);
+        return const_reverse_iterator(slot(temp), slot(0));
     }
 
     /**
@@ -338,9 +486,9 @@ class ring_buffer {
      */
     reverse_iterator rend() {
         if ( full() ) {
-            return reverse_iterator(nullptr, m_buffer);
+            return reverse_iterator(nullptr, slot(0));
         }
-        return reverse_iterator(&m_buffer[m_tail], m_buffer);
+        return reverse_iterator(slot(m_tail), slot(0));
     }
 
     /**
@@ -350,9 +498,9 @@ class ring_buffer {
      */
     const_reverse_iterator crend() {
         if ( full() ) {
-            return const_reverse_iterator(nullptr, m_buffer);
+            return const_reverse_iterator(nullptr, slot(0));
         }
-        return const_reverse_iterator(&m_buffer[m_tail], m_buffer);
+        return const_reverse_iterator(slot(m_tail), slot(0));
     }
 
     /**
@@ -386,20 +534,50 @@ class ring_buffer {
      * \brief Flushes all items from the buffer
      */
     void flush() {
-        while ( pop_front().has_value() ) {
-        }
+        commit_read(m_size);
     }
 
   private:
+    //!< Indices wrap with a mask instead of a compare when the capacity is a power of two
+    static constexpr bool is_power_of_two = (MaxCapacity & (MaxCapacity - 1)) == 0;
+
+    /**
+     * \brief Helper to get the storage of a slot
+     * 
+     * \param index The slot index
+     * \return T* Pointer to the slot
+     */
+    inline T* slot(std::size_t index) {
+        return std::launder(reinterpret_cast<T*>(m_storage)) + index;
+    }
+
+    /**
+     * \brief Helper to wrap an index that is less than twice the capacity back into the buffer
+     * 
+     * \param index The index to wrap
+     * \return std::size_t The wrapped index
+     */
+    static inline std::size_t wrap(std::size_t index) {
+        if constexpr ( is_power_of_two ) {
+            return index & (MaxCapacity - 1);
+        } else {
+            return (index >= MaxCapacity) ? index - MaxCapacity : index;
+        }
+    }
+
     /**
      * \brief Helper to increment an index
      * 
      * \param index The index to increment
      */
     inline void increment(std::size_t& index) {
-        index++;
-        if ( index >= MaxCapacity ) {
-            index = 0;
+        if constexpr ( is_power_of_two ) {
+            index = (index + 1) & (MaxCapacity - 1);
+        } else {
+            index++;
+            if ( index >= MaxCapacity ) {
+                index = 0;
+            }
         }
     }
 
@@ -409,14 +587,18 @@ class ring_buffer {
      * \param index The index to decrement
      */
     inline void decrement(std::size_t& index) {
-        if ( index == 0 ) {
-            index = MaxCapacity - 1;
+        if constexpr ( is_power_of_two ) {
+            index = (index - 1) & (MaxCapacity - 1);
         } else {
-            index--;
+            if ( index == 0 ) {
+                index = MaxCapacity - 1;
+            } else {
+                index--;
+            }
         }
     }
 
-    T m_buffer[MaxCapacity];
+    alignas(T) std::byte m_storage[sizeof(T) * MaxCapacity];
     std::size_t m_head = 0;
     std::size_t m_tail = 0;
     std::size_t m_size = 0;    
@@ -4,6 +4,7 @@
 /********************************** Includes *******************************************/
 #include "scheduler.hpp"
 #include "device_port.hpp"
+#include "interrupt_lock_guard.hpp"
 #include "thread.hpp"
 
 namespace os
@@ -13,6 +14,9 @@ constexpr uint8_t internal_thread_stack_size = 64;
 
 static void internal_thread_task() {
     while ( true ) {
+#if defined(OS_TICKLESS_IDLE)
+        scheduler::idle();
+#endif
     }
 }
 
@@ -20,7 +24,7 @@ static uint32_t internal_thread_stack[internal_thread_stack_size] = {0};
 static os::thread internal_thread(internal_thread_task, 0xFFFF, internal_thread_stack, internal_thread_stack_size);
 
 scheduler::scheduler()
-    : scheduler_impl(MAX_THREAD_COUNT, set_pending_context_switch, is_context_switch_pending)
+    : static_scheduler(set_pending_context_switch, is_context_switch_pending)
     , m_locked(false) {
     set_internal_task(&internal_thread);
 }
@@ -49,6 +53,76 @@ void scheduler::sleep(uint32_t ticks) {
     ENABLE_INTERRUPTS();
 }
 
+void scheduler::yield() {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    self.yield_thread();
+    ENABLE_INTERRUPTS();
+}
+
+void scheduler::set_period(uint32_t period, uint32_t relative_deadline) {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    self.set_thread_period(period, relative_deadline);
+    ENABLE_INTERRUPTS();
+}
+
+void scheduler::wait_for_next_period() {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    self.complete_thread_job();
+    ENABLE_INTERRUPTS();
+}
+
+bool scheduler::set_budget(thread* thread, cpu_budget& budget) {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    bool retval = self.assign_budget(thread, &budget);
+    ENABLE_INTERRUPTS();
+    return retval;
+}
+
+bool scheduler::set_preemption_threshold(thread* thread, uint32_t threshold) {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    bool retval = self.assign_preemption_threshold(thread, threshold);
+    ENABLE_INTERRUPTS();
+    return retval;
+}
+
+bool scheduler::notify(task_control_block* tcb, uint32_t value, notify_action action) {
+    auto& self = get();
+    // May be called from an interrupt handler, so leave the caller's interrupt state as it was
+    os::interrupt_restore_guard guard;
+    return self.notify_thread(tcb, value, action);
+}
+
+uint32_t scheduler::take_notification(bool clear, uint32_t timeout) {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    self.block_on_notification(0, timeout);
+    ENABLE_INTERRUPTS();
+
+    // Running again, either notified or after the timeout
+    DISABLE_INTERRUPTS();
+    auto count = self.take_notification_count(clear);
+    ENABLE_INTERRUPTS();
+    return count;
+}
+
+std::optional<uint32_t> scheduler::wait_for_notification(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t timeout) {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    self.block_on_notification(clear_on_entry, timeout);
+    ENABLE_INTERRUPTS();
+
+    // Running again, either notified or after the timeout
+    DISABLE_INTERRUPTS();
+    auto value = self.take_notification_value(clear_on_exit);
+    ENABLE_INTERRUPTS();
+    return value;
+}
+
 task_control_block* scheduler::get_active_task_control_block() {
     auto& self = get();
     return self.get_active_tcb_ptr();
@@ -74,6 +148,15 @@ void scheduler::update_system_ticks(uint32_t ticks) {
     self.m_clock.update(ticks);
 }
 
+void scheduler::idle() {
+    auto& self = get();
+    DISABLE_INTERRUPTS();
+    if ( !self.m_locked ) {
+        self.enter_tickless_idle(suppress_ticks_and_sleep);
+    }
+    ENABLE_INTERRUPTS();
+}
+
 void scheduler::lock() {
     DISABLE_INTERRUPTS();
     auto& self = get();
@@ -6,6 +6,7 @@
 /********************************** Includes *******************************************/
 #include "scheduler_impl.hpp"
 #include "thread.hpp"
+#include <optional>
 #include <type_traits>
 #include <utility>
 
@@ -15,7 +16,7 @@ namespace os
 /**
  * \brief Singleton accessor for the scheduler
  */
-class scheduler : public scheduler_impl {
+class scheduler : public static_scheduler<MAX_THREAD_COUNT> {
   public:
     /**
      * \brief Singleton accessor for the scheduler
@@ -41,6 +42,74 @@ class scheduler : public scheduler_impl {
      */
     static void sleep(uint32_t ticks);
 
+    /**
+     * \brief Give up the rest of the calling thread's time slice to other ready threads of the same priority
+     */
+    static void yield();
+
+    /**
+     * \brief Make the calling thread periodic with a deadline relative to each job release
+     * 
+     * \param period Ticks between job releases
+     * \param relative_deadline Ticks after each release that the job must finish by
+     */
+    static void set_period(uint32_t period, uint32_t relative_deadline);
+
+    /**
+     * \brief Finish the calling thread's current job and sleep until the next one is released
+     */
+    static void wait_for_next_period();
+
+    /**
+     * \brief Charge a thread's CPU time to a budget group. Threads of a group that used up its budget are demoted
+     *        until the budget is replenished
+     * 
+     * \param thread The thread
+     * \param budget The budget group, which must outlive the thread
+     * \retval bool True if the thread is registered with the scheduler
+     */
+    static bool set_budget(thread* thread, cpu_budget& budget);
+
+    /**
+     * \brief Set the preemption threshold of a thread. While it runs, only threads with a higher priority than the
+     *        threshold can preempt it
+     * 
+     * \param thread The thread
+     * \param threshold Priority threshold no lower than the thread's priority, or no_preemption_threshold
+     * \retval bool True if the thread is registered and the threshold is valid
+     */
+    static bool set_preemption_threshold(thread* thread, uint32_t threshold);
+
+    /**
+     * \brief Send a direct-to-thread notification. Safe to call from an interrupt or with interrupts disabled, as the
+     *        caller's interrupt state is restored afterwards
+     * 
+     * \param tcb Task control block of the thread to notify
+     * \param value Value used by the action
+     * \param action How the thread's notification value is updated
+     * \retval bool False if the action is overwrite_if_empty and a notification is already pending
+     */
+    static bool notify(task_control_block* tcb, uint32_t value, notify_action action);
+
+    /**
+     * \brief Wait for the calling thread to be notified and take its notification value as a count
+     * 
+     * \param clear True to clear the count, or false to decrement it
+     * \param timeout Max ticks to wait for, or wait_forever
+     * \retval uint32_t The count before it was taken, zero if the wait timed out
+     */
+    static uint32_t take_notification(bool clear, uint32_t timeout);
+
+    /**
+     * \brief Wait for the calling thread to be notified and read its notification value
+     * 
+     * \param clear_on_entry Bits to clear from the value before waiting if no notification is pending
+     * \param clear_on_exit Bits to clear from the value once it is read
+     * \param timeout Max ticks to wait for, or wait_forever
+     * \retval optional<uint32_t> The notification value, or nullopt if the wait timed out
+     */
+    static std::optional<uint32_t> wait_for_notification(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t timeout);
+
     /**
      * \brief Get the active task control block
      * 
@@ -74,6 +143,11 @@ class scheduler : public scheduler_impl {
      */
     static void update_system_ticks(uint32_t ticks);
 
+    /**
+     * \brief Idle with the tick interrupt suppressed until the next thread is due to wake up
+     */
+    static void idle();
+
     /**
      * \brief Lock the scheduler to perform atomic operations without interrupting
      */
@@ -107,6 +181,78 @@ static inline void sleep_for_msec(Duration&& duration_msec) {
     static_assert(std::is_convertible_v<uint32_t, Duration>, "Sleep interval must be convertible to integral constant");
     os::scheduler::sleep(static_cast<uint32_t>(std::forward<Duration>(duration_msec)));
 }
+
+/**
+ * \brief Helper function inline with std::this_thread::yield that lets other threads of the same priority run
+ */
+static inline void yield() {
+    os::scheduler::yield();
+}
+
+/**
+ * \brief Make the calling thread periodic. Its first job is released right away
+ * 
+ * \param period Ticks between job releases
+ * \param relative_deadline Ticks after each release that the job must finish by
+ */
+static inline void set_period(uint32_t period, uint32_t relative_deadline) {
+    os::scheduler::set_period(period, relative_deadline);
+}
+
+/**
+ * \brief Finish the current job of a periodic thread and sleep until the next one is released
+ */
+static inline void wait_for_next_period() {
+    os::scheduler::wait_for_next_period();
+}
+
+/**
+ * \brief Wait for a notification given with os::notify_give, using the calling thread's notification value as a
+ *        binary or counting semaphore
+ * 
+ * \param clear_on_exit True to clear the count once taken, or false to decrement it by one
+ * \param timeout Max ticks to wait for, or wait_forever
+ * \retval uint32_t The count before it was taken, zero if the wait timed out
+ */
+static inline uint32_t notify_take(bool clear_on_exit = true, uint32_t timeout = scheduler::wait_forever) {
+    return os::scheduler::take_notification(clear_on_exit, timeout);
+}
+
+/**
+ * \brief Wait for a notification sent with os::notify and read the calling thread's notification value, for example
+ *        to wait for event bits set by an interrupt
+ * 
+ * \param clear_on_entry Bits to clear from the value before waiting if no notification is pending
+ * \param clear_on_exit Bits to clear from the value once it is read
+ * \param timeout Max ticks to wait for, or wait_forever
+ * \retval optional<uint32_t> The notification value, or nullopt if the wait timed out
+ */
+static inline std::optional<uint32_t> notify_wait(uint32_t clear_on_entry, uint32_t clear_on_exit,
+                                                  uint32_t timeout = scheduler::wait_forever) {
+    return os::scheduler::wait_for_notification(clear_on_entry, clear_on_exit, timeout);
+}
 }  // namespace this_thread
 
+/**
+ * \brief Notify a thread directly without a separate synchronization object. Safe to call from an interrupt
+ * 
+ * \param tcb Task control block of the thread to notify
+ * \param value Value used by the action
+ * \param action How the thread's notification value is updated
+ * \retval bool False if the action is overwrite_if_empty and a notification is already pending
+ */
+static inline bool notify(task_control_block* tcb, uint32_t value, notify_action action) {
+    return os::scheduler::notify(tcb, value, action);
+}
+
+/**
+ * \brief Give a thread a notification to be taken with os::this_thread::notify_take, like releasing a semaphore.
+ *        Safe to call from an interrupt
+ * 
+ * \param tcb Task control block of the thread to notify
+ */
+static inline void notify_give(task_control_block* tcb) {
+    os::scheduler::notify(tcb, 0, notify_action::increment);
+}
+
 };  // namespace os
\ No newline at end of file
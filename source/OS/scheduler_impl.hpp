@@ -4,17 +4,30 @@
 #pragma once
 
 /********************************** Includes *******************************************/
+#include "cpu_budget.hpp"
+#include "owned_lock.hpp"
+#include "scheduling_policy.hpp"
+#include "sleep_list.hpp"
 #include "task_control_block.hpp"
 #include "thread.hpp"
 #include "system_clock.hpp"
-#include <memory>
+#include "wait_queue.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <optional>
+#include <span>
 
 
 namespace os
 {
-//!< Scheduler implementation details
-class scheduler_impl {
+/**
+ * \brief Scheduler implementation details
+ *
+ * \tparam Policy Scheduling policy that orders the ready threads, see scheduling_policy.hpp
+ */
+template <typename Policy>
+class basic_scheduler_impl {
   public:
     /**
     * \brief Function pointer for setting a pending interrupt with the scheduler. This injects
@@ -28,59 +41,67 @@ class scheduler_impl {
     */
     using is_interrupt_pending = bool (*)();
 
+    /**
+    * \brief Function pointer to a low power sleep that suppresses the tick interrupt for up to a number of ticks.
+    *        It is called with interrupts disabled and returns how many whole ticks actually elapsed, which may be
+    *        fewer than requested if another interrupt woke the processor early.
+    */
+    using suppress_ticks_and_sleep = uint32_t (*)(uint32_t idle_ticks);
+
+    //!< Minimum number of idle ticks before it is worth stopping the tick interrupt
+    static constexpr uint32_t tickless_idle_threshold = 2;
+
+    //!< Timeout for blocking on a wait queue until it is signaled
+    static constexpr uint32_t wait_forever = UINT32_MAX;
+
+    //!< Preemption threshold of threads that any thread chosen by the scheduling policy may preempt
+    static constexpr uint32_t no_preemption_threshold = UINT32_MAX;
+
     /**
      * \brief Construct a new scheduler
      * 
-     * \param clock_source System clock source for running the scheduler
-     * \param max_thread_count Max number of threads to allow
+     * \param task_control_blocks Storage for the task control blocks. The size sets the max number of threads
      * \param set_pending Function pointer to the function to set a pending context switch interrupt
      * \param check_pending Function pointer to check if an interrupt is already pending
      */
-    scheduler_impl(unsigned max_thread_count,
-                   set_pending_interrupt set_pending,
-                   is_interrupt_pending check_pending)        
-        : m_max_thread_count(max_thread_count)
+    basic_scheduler_impl(std::span<task_control_block> task_control_blocks,
+                         set_pending_interrupt set_pending,
+                         is_interrupt_pending check_pending)        
+        : m_max_thread_count(static_cast<unsigned>(task_control_blocks.size()))
         , m_set_pending(set_pending)
         , m_check_pending(check_pending)
-        , m_last_tick(0)
         , m_thread_count(0)
-        , m_task_control_blocks(std::make_unique<task_control_block[]>(m_max_thread_count))
+        , m_task_control_blocks(task_control_blocks)
         , m_active_task(&m_task_control_blocks[0])
         , m_pending_task(nullptr)
-        , m_internal_task() { }
+        , m_internal_task()
+        , m_policy()
+        , m_sleep_list()
+        , m_budgets(nullptr) { }
 
     /**
      * \brief Run the scheduling algorithm and signal any context switches to the PendSV handler if required.
      */
     void run() {
         uint32_t current_tick{m_clock.get_ticks()};
-        uint32_t ticks{current_tick - m_last_tick};
-
-        for ( unsigned thread = 0; thread < m_thread_count; thread++ ) {
-            auto tcb = &m_task_control_blocks[thread];
 
-            // Pick up any threads that are waking up from sleep
-            if ( tcb->thread_ptr->get_status() == thread::status::sleeping ) {
-                tcb->suspended_ticks_remaining -= ticks;
-                if ( (tcb->suspended_ticks_remaining) <= 0 ) {
-                    tcb->thread_ptr->set_status(thread::status::pending);
-                }
-            }
+        // Wake up every thread that is due. The sleep list is sorted so only expired threads are visited
+        while ( auto* tcb = m_sleep_list.pop_expired(current_tick) ) {
+            leave_wait_queue(tcb, wait_result::timed_out);
+            make_ready(tcb);
         }
 
-        // Pick up any pending tasks and context switch if required
+        // Lift throttling for budget groups that are due, then bill the tick to the active thread's group
+        replenish_budgets(current_tick);
+        charge_budget(current_tick);
+
+        // Let the policy requeue the active thread, then preempt it if another thread should now run
         if ( !m_check_pending() ) {
-            for ( unsigned thread = 0; thread < m_thread_count; thread++ ) {
-                auto tcb = &m_task_control_blocks[thread];
-                if ( tcb->thread_ptr->get_status() == thread::status::pending ) {
-                    m_active_task->thread_ptr->set_status(thread::status::pending);
-                    context_switch_to(tcb);
-                    break;
-                }
+            if ( m_active_task != &m_internal_task ) {
+                m_policy.on_tick(m_active_task, current_tick);
             }
+            preempt_if_outranked();
         }
-
-        m_last_tick = current_tick;
     }
 
     /**
@@ -90,19 +111,427 @@ class scheduler_impl {
      * \param ticks How many ticks to sleep the active thread for
      */
     void sleep_thread(uint32_t ticks) {
-        m_active_task->suspended_ticks_remaining = ticks;
-        m_active_task->thread_ptr->set_status(os::thread::status::sleeping);
+        m_active_task->wake_tick = m_clock.get_ticks() + ticks;
+        block_active_task(os::thread::status::sleeping);
+        m_sleep_list.insert(m_active_task);
         jump_to_next_pending_task();
     }
 
+    /**
+     * \brief Give up the rest of the active thread's time slice by requeueing it behind the other ready threads it
+     *        shares a place with under the scheduling policy. The thread keeps running if no such thread is ready.
+     */
+    void yield_thread() {
+        if ( m_active_task != &m_internal_task ) {
+            m_policy.on_block(m_active_task);
+            m_policy.on_ready(m_active_task);
+        }
+        auto* next = get_next_ready_task();
+        if ( next != m_active_task ) {
+            context_switch_to(next);
+        } else if ( next != &m_internal_task ) {
+            m_policy.on_dispatch(next, m_clock.get_ticks());
+        }
+    }
+
+    /**
+     * \brief Make the active thread periodic. Its first job is released now and must finish within relative_deadline
+     *        ticks. The thread ends each job with complete_thread_job. Deadlines order the ready threads under the
+     *        earliest deadline first policy, and deadline misses are counted in the task control block.
+     * 
+     * \param period Ticks between job releases
+     * \param relative_deadline Ticks after each release that the job must finish by, zero for no deadline
+     */
+    void set_thread_period(uint32_t period, uint32_t relative_deadline) {
+        auto* tcb = m_active_task;
+        if ( tcb == &m_internal_task ) {
+            return;
+        }
+        uint32_t now = m_clock.get_ticks();
+        m_policy.on_block(tcb);
+        tcb->period = period;
+        tcb->relative_deadline = relative_deadline;
+        tcb->release_tick = now;
+        tcb->absolute_deadline = now + relative_deadline;
+        tcb->deadline_missed = false;
+        m_policy.on_ready(tcb);
+        preempt_if_outranked();
+    }
+
+    /**
+     * \brief Finish the active thread's current job and sleep until the next job is released. A job that finishes
+     *        after its deadline is counted as a deadline miss, and a job that overran into the next period releases
+     *        the next job right away.
+     */
+    void complete_thread_job() {
+        auto* tcb = m_active_task;
+        if ( (tcb == &m_internal_task) || (tcb->period == 0) ) {
+            return;
+        }
+        uint32_t now = m_clock.get_ticks();
+        if ( (tcb->relative_deadline != 0) && !tcb->deadline_missed &&
+             (static_cast<int32_t>(now - tcb->absolute_deadline) > 0) ) {
+            tcb->deadline_misses++;
+        }
+
+        m_policy.on_block(tcb);
+        tcb->release_tick += tcb->period;
+        tcb->absolute_deadline = tcb->release_tick + tcb->relative_deadline;
+        tcb->deadline_missed = false;
+        if ( sleep_list::tick_reached(now, tcb->release_tick) ) {
+            m_policy.on_ready(tcb);
+            preempt_if_outranked();
+        } else {
+            tcb->wake_tick = tcb->release_tick;
+            tcb->thread_ptr->set_status(thread::status::sleeping);
+            m_sleep_list.insert(tcb);
+            jump_to_next_pending_task();
+        }
+    }
+
+    /**
+     * \brief Charge a thread's CPU time to a budget group. Budget groups can be shared by any number of threads
+     * 
+     * \param thread The thread, which must already be registered
+     * \param budget The budget group, or nullptr to stop charging the thread to a group
+     * \retval bool True if the thread is registered with the scheduler
+     */
+    bool assign_budget(thread* thread, cpu_budget* budget) {
+        for ( unsigned i = 0; i < m_thread_count; i++ ) {
+            auto* tcb = &m_task_control_blocks[i];
+            if ( tcb->thread_ptr != thread ) {
+                continue;
+            }
+            if ( (budget != nullptr) && !is_known_budget(budget) ) {
+                budget->next = m_budgets;
+                m_budgets = budget;
+            }
+            tcb->budget = budget;
+            update_priority(tcb);
+            preempt_if_outranked();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * \brief Set the preemption threshold of a thread. While the thread runs, only threads with a higher priority than
+     *        the threshold preempt it, so threads with priorities between the threshold and the thread's own priority
+     *        wait until it blocks. Giving a group of cooperating threads the same threshold stops them preempting one
+     *        another, which saves context switches and means at most one of them is ever part way through its work.
+     * 
+     * \param thread The thread, which must already be registered
+     * \param threshold Priority threshold no lower than the thread's priority, or no_preemption_threshold
+     * \retval bool True if the thread is registered and the threshold is valid
+     */
+    bool assign_preemption_threshold(thread* thread, uint32_t threshold) {
+        for ( unsigned i = 0; i < m_thread_count; i++ ) {
+            auto* tcb = &m_task_control_blocks[i];
+            if ( tcb->thread_ptr != thread ) {
+                continue;
+            }
+            if ( (threshold != no_preemption_threshold) && (threshold > tcb->base_priority) ) {
+                return false;
+            }
+            tcb->preemption_threshold = threshold;
+
+            // Relaxing the threshold of the active thread can let a waiting thread in
+            preempt_if_outranked();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * \brief Get the scheduling policy to configure it
+     * 
+     * \retval Policy& The policy
+     */
+    Policy& policy() {
+        return m_policy;
+    }
+
     /**
      * \brief Suspends the calling thread and triggers a context switch to the next available thread
      */
     void suspend_thread() {
-        m_active_task->thread_ptr->set_status(os::thread::status::suspended);
+        block_active_task(os::thread::status::suspended);
         jump_to_next_pending_task();
     }
 
+    /**
+     * \brief Move a suspended or sleeping thread back into the set of threads that are ready to run. If the thread
+     *        has a higher priority than the active thread, a context switch is requested right away instead of
+     *        waiting for the next tick. Called from an interrupt, the switch tail-chains when the interrupt returns.
+     * 
+     * \param tcb The task control block of the thread to resume
+     */
+    void resume_thread(task_control_block* tcb) {
+        auto status = tcb->thread_ptr->get_status();
+        if ( status == thread::status::sleeping ) {
+            m_sleep_list.remove(tcb);
+        }
+        if ( (status == thread::status::suspended) || (status == thread::status::sleeping) ) {
+            leave_wait_queue(tcb, wait_result::interrupted);
+            make_ready(tcb);
+            preempt_if_outranked();
+        }
+    }
+
+    /**
+     * \brief Block the active thread on a wait queue until it is woken up by wake_one or wake_all, or until the timeout
+     *        expires. A thread with a timeout is parked on both the wait queue and the sleep list, and is taken off
+     *        whichever one did not wake it. Must be called with interrupts disabled. The outcome is stored in the
+     *        wait_status of the thread's task control block once it runs again. A zero timeout times out right away
+     *        without blocking.
+     * 
+     * \param queue The queue to wait on
+     * \param timeout Max ticks to wait for, or wait_forever
+     */
+    void block_on(wait_queue& queue, uint32_t timeout = wait_forever) {
+        auto* tcb = m_active_task;
+        if ( timeout == 0 ) {
+            tcb->wait_status = wait_result::timed_out;
+            return;
+        }
+        tcb->wait_status = wait_result::none;
+        tcb->waiting_on = &queue;
+        queue.insert(tcb);
+        park_active_task(timeout);
+    }
+
+    /**
+     * \brief Wake up the first thread waiting on a queue. The woken thread preempts the caller if it has a higher
+     *        priority.
+     * 
+     * \param queue The queue to signal
+     * \retval task_control_block* The woken thread or nullptr if no threads were waiting
+     */
+    task_control_block* wake_one(wait_queue& queue) {
+        auto* tcb = queue.front();
+        if ( tcb != nullptr ) {
+            leave_wait_queue(tcb, wait_result::signaled);
+            resume_thread(tcb);
+        }
+        return tcb;
+    }
+
+    /**
+     * \brief Wake up every thread waiting on a queue
+     * 
+     * \param queue The queue to signal
+     * \retval unsigned Number of threads woken up
+     */
+    unsigned wake_all(wait_queue& queue) {
+        unsigned count{0};
+        while ( wake_one(queue) != nullptr ) {
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * \brief Send a direct-to-thread notification. The notification value in the thread's task control block is
+     *        updated by the action and the notification is marked pending. If the thread is blocked waiting for a
+     *        notification it is woken up, and preempts the caller if it has a higher priority. Must be called with
+     *        interrupts disabled, and is safe to call from an interrupt.
+     * 
+     * \param tcb The thread to notify
+     * \param value Value used by the action
+     * \param action How the notification value is updated
+     * \retval bool False if the action is overwrite_if_empty and a notification is already pending, in which case
+     *              nothing is changed
+     */
+    bool notify_thread(task_control_block* tcb, uint32_t value, notify_action action) {
+        auto previous = tcb->notification;
+        switch ( action ) {
+            case notify_action::no_action:
+                break;
+            case notify_action::increment:
+                tcb->notification_value++;
+                break;
+            case notify_action::set_bits:
+                tcb->notification_value |= value;
+                break;
+            case notify_action::overwrite:
+                tcb->notification_value = value;
+                break;
+            case notify_action::overwrite_if_empty:
+                if ( previous == notification_state::pending ) {
+                    return false;
+                }
+                tcb->notification_value = value;
+                break;
+        }
+        tcb->notification = notification_state::pending;
+        if ( previous == notification_state::waiting ) {
+            tcb->wait_status = wait_result::signaled;
+            resume_thread(tcb);
+        }
+        return true;
+    }
+
+    /**
+     * \brief Block the active thread until it is notified, or until the timeout expires. Returns right away if a
+     *        notification is already pending. Otherwise the bits in clear_on_entry are cleared from the notification
+     *        value first. Must be called with interrupts disabled, and the outcome is stored in the wait_status of
+     *        the thread's task control block once it runs again. A zero timeout times out right away without blocking.
+     * 
+     * \param clear_on_entry Bits to clear from the notification value if no notification is pending
+     * \param timeout Max ticks to wait for, or wait_forever
+     */
+    void block_on_notification(uint32_t clear_on_entry, uint32_t timeout = wait_forever) {
+        auto* tcb = m_active_task;
+        if ( tcb->notification == notification_state::pending ) {
+            tcb->wait_status = wait_result::signaled;
+            return;
+        }
+        tcb->notification_value &= ~clear_on_entry;
+        if ( timeout == 0 ) {
+            tcb->wait_status = wait_result::timed_out;
+            return;
+        }
+        tcb->wait_status = wait_result::none;
+        tcb->notification = notification_state::waiting;
+        park_active_task(timeout);
+    }
+
+    /**
+     * \brief Take the pending notification of the active thread, using its value as a count. The count is cleared to
+     *        zero or decremented by one, and the notification stays pending while the count is above zero.
+     * 
+     * \param clear True to clear the count, like taking a binary semaphore, or false to decrement it, like taking a
+     *              counting semaphore
+     * \retval uint32_t The count before it was taken, zero if the thread was not notified
+     */
+    uint32_t take_notification_count(bool clear) {
+        auto* tcb = m_active_task;
+        if ( tcb->notification != notification_state::pending ) {
+            tcb->notification = notification_state::none;
+            return 0;
+        }
+        auto count = tcb->notification_value;
+        if ( clear || (count <= 1) ) {
+            tcb->notification_value = 0;
+            tcb->notification = notification_state::none;
+        } else {
+            tcb->notification_value = count - 1;
+        }
+        return count;
+    }
+
+    /**
+     * \brief Take the pending notification of the active thread and clear bits from its value
+     * 
+     * \param clear_on_exit Bits to clear from the notification value once it is read
+     * \retval optional<uint32_t> The notification value before the bits were cleared, or nullopt if the thread was
+     *                             not notified
+     */
+    std::optional<uint32_t> take_notification_value(uint32_t clear_on_exit) {
+        auto* tcb = m_active_task;
+        if ( tcb->notification != notification_state::pending ) {
+            tcb->notification = notification_state::none;
+            return {};
+        }
+        auto value = tcb->notification_value;
+        tcb->notification_value &= ~clear_on_exit;
+        tcb->notification = notification_state::none;
+        return value;
+    }
+
+    /**
+     * \brief Take ownership of a lock for the active thread if no other thread owns it. A lock with a ceiling raises
+     *        the active thread to the ceiling priority right away.
+     * 
+     * \param lock The lock to take
+     * \retval bool True if the active thread now owns the lock
+     */
+    bool try_take_lock(owned_lock& lock) {
+        return try_take_lock(lock, m_active_task);
+    }
+
+    /**
+     * \brief Take ownership of a lock on behalf of a thread if no other thread owns it. This lets a lock be handed to
+     *        the thread that runs a waiting coroutine.
+     * 
+     * \param lock The lock to take
+     * \param tcb The thread to take the lock for
+     * \retval bool True if the thread now owns the lock
+     */
+    bool try_take_lock(owned_lock& lock, task_control_block* tcb) {
+        if ( lock.owner != nullptr ) {
+            return false;
+        }
+        grant_lock(lock, tcb);
+        if ( lock.ceiling < tcb->priority ) {
+            set_effective_priority(tcb, lock.ceiling);
+        }
+        return true;
+    }
+
+    /**
+     * \brief Block the active thread until it is handed ownership of a lock by release_lock. While it waits, the owner
+     *        of the lock, and the owner of any lock that owner is itself waiting on, inherits the priority of the
+     *        waiting thread if it is higher. Must be called with interrupts disabled.
+     * 
+     * \param lock The lock to wait for
+     * \param timeout Max ticks to wait for, or wait_forever
+     */
+    void block_on_lock(owned_lock& lock, uint32_t timeout = wait_forever) {
+        auto* tcb = m_active_task;
+        block_on(lock.waiters, timeout);
+        if ( tcb->waiting_on != nullptr ) {
+            tcb->blocked_on = &lock;
+            update_priority(lock.owner);
+
+            // The switch away from the blocked thread has not happened yet, so the thread it targets has not really
+            // started running and is not protected by its preemption threshold
+            auto* next = get_next_ready_task();
+            if ( next != m_active_task ) {
+                context_switch_to(next);
+            }
+        }
+    }
+
+    /**
+     * \brief Release a lock owned by the active thread. The releasing thread drops back to the highest of its base
+     *        priority and the priorities inherited from the locks it still holds, and ownership is handed directly to
+     *        the highest priority waiting thread. Must be called with interrupts disabled.
+     * 
+     * \param lock The lock to release
+     * \retval bool False if the lock is not held, or is held by another thread, in which case nothing changes
+     */
+    bool release_lock(owned_lock& lock) {
+        auto* owner = lock.owner;
+        if ( (owner == nullptr) || (owner != m_active_task) ) {
+            return false;
+        }
+        for ( auto** link = &owner->held_locks; *link != nullptr; link = &(*link)->next_held ) {
+            if ( *link == &lock ) {
+                *link = lock.next_held;
+                break;
+            }
+        }
+        lock.next_held = nullptr;
+        lock.owner = nullptr;
+        update_priority(owner);
+
+        if ( auto* next = lock.waiters.front() ) {
+            grant_lock(lock, next);
+            wake_one(lock.waiters);
+        }
+        preempt_if_outranked();
+        return true;
+    }
+
+    /**
+     * \brief Select the highest priority ready thread as the active thread. This is called once before entering the
+     *        kernel so that the first thread to run respects thread priorities.
+     */
+    void select_initial_task() {
+        m_active_task = get_next_ready_task();
+    }
+
     /**
      * \brief Register a thread with the scheduler
      * 
@@ -111,10 +540,13 @@ class scheduler_impl {
      */
     bool register_thread(thread* thread) {
         bool retval{false};
-        if ( m_thread_count < m_max_thread_count ) {
+        if ( (m_thread_count < m_max_thread_count) && (thread->get_priority() < MAX_THREAD_PRIORITIES) ) {
             // Add the the thread object and its stack pointer to the next empty task control block
             m_task_control_blocks[m_thread_count].thread_ptr = thread;
             m_task_control_blocks[m_thread_count].active_stack_pointer = thread->get_stack_ptr();
+            m_task_control_blocks[m_thread_count].priority = thread->get_priority();
+            m_task_control_blocks[m_thread_count].base_priority = thread->get_priority();
+            m_task_control_blocks[m_thread_count].preemption_threshold = no_preemption_threshold;
 
             // Setup the next pointers
             m_task_control_blocks[m_thread_count].next = (m_thread_count == 0) ? nullptr : &m_task_control_blocks[0];
@@ -129,6 +561,10 @@ class scheduler_impl {
             //     m_pending_task = &m_task_control_blocks[m_thread_count];
             // }
 
+            if ( thread->get_status() == thread::status::pending ) {
+                m_policy.on_ready(&m_task_control_blocks[m_thread_count]);
+            }
+
             m_thread_count++;
             retval = true;
         }
@@ -136,14 +572,17 @@ class scheduler_impl {
     }
 
     /**
-     * \brief Register a thread as the internal OS thread that will run when all other threads are sleeping
+     * \brief Register a thread as the internal OS thread that will run when all other threads are sleeping. It ranks
+     *        below every thread priority so any thread that becomes ready preempts it.
      * \param thread Pointer to the thread to register
      * \todo could maybe move this into the task constructor?
      */
     void set_internal_task(thread* thread) {
         m_internal_task.thread_ptr = thread;
         m_internal_task.active_stack_pointer = thread->get_stack_ptr();
-        m_internal_task.suspended_ticks_remaining = 0;
+        m_internal_task.wake_tick = 0;
+        m_internal_task.priority = MAX_THREAD_PRIORITIES;
+        m_internal_task.base_priority = MAX_THREAD_PRIORITIES;
     }
 
     /**
@@ -217,6 +656,40 @@ class scheduler_impl {
         m_clock.update(ticks);
     }
 
+    /**
+     * \brief Get the number of ticks until the next sleeping thread wakes up
+     * 
+     * \retval std::optional<uint32_t> Ticks until the next wakeup, or empty if no threads are sleeping
+     */
+    std::optional<uint32_t> get_ticks_until_next_wakeup() {
+        auto* tcb = m_sleep_list.front();
+        if ( tcb == nullptr ) {
+            return {};
+        }
+        auto now = m_clock.get_ticks();
+        return sleep_list::tick_reached(now, tcb->wake_tick) ? 0 : tcb->wake_tick - now;
+    }
+
+    /**
+     * \brief Idle until the next thread wakes up with the tick interrupt suppressed. The elapsed ticks reported by the
+     *        sleep function are credited back to the system clock and the scheduler is run to pick up any threads that
+     *        are now due. Must be called with interrupts disabled from the internal OS thread.
+     * 
+     * \param sleep Platform function that stops the tick, sleeps, and reports the elapsed ticks
+     */
+    void enter_tickless_idle(suppress_ticks_and_sleep sleep) {
+        if ( m_policy.pick_next() != nullptr ) {
+            return;
+        }
+        auto idle_ticks = get_ticks_until_next_wakeup().value_or(UINT32_MAX);
+        if ( idle_ticks < tickless_idle_threshold ) {
+            return;
+        }
+        auto elapsed_ticks = sleep(idle_ticks);
+        m_clock.update(elapsed_ticks);
+        run();
+    }
+
   protected:
     /**
      * \brief trigger a context switch to the thread pointer to by the task control block
@@ -224,41 +697,333 @@ class scheduler_impl {
      * \param tcb pointer to the task control block
      */
     void context_switch_to(task_control_block* tcb) {
+        // The outgoing thread stays in the ready list if it was preempted rather than blocked
+        if ( (m_active_task->thread_ptr != nullptr) && (m_active_task->thread_ptr->get_status() == thread::status::active) ) {
+            m_active_task->thread_ptr->set_status(thread::status::pending);
+        }
         m_pending_task = tcb;
         tcb->thread_ptr->set_status(thread::status::active);
         m_active_task = m_pending_task;
+        if ( tcb != &m_internal_task ) {
+            m_policy.on_dispatch(tcb, m_clock.get_ticks());
+        }
         m_set_pending();
     }
 
     /**
-     * \brief jump to the next available task
+     * \brief jump to the next available task after the active task has blocked. This always re-targets the pending
+     *        context switch as the active task can no longer run.
      */
     void jump_to_next_pending_task() {
-        // Find the next active thread if a context switch is not already pending
-        if ( !m_check_pending() ) {
-            for ( unsigned thread = 0; thread < m_thread_count; thread++ ) {
-                auto tcb = &m_task_control_blocks[thread];
-                if ( (tcb->thread_ptr->get_status() == thread::status::pending) && (tcb != m_active_task) ) {
-                    context_switch_to(tcb);
-                    return;
+        context_switch_to(get_next_ready_task());
+    }
+
+    /**
+     * \brief Get the ready thread that the scheduling policy wants to run
+     * 
+     * \retval task_control_block* The next thread to run, or the internal OS thread if no threads are ready
+     */
+    task_control_block* get_next_ready_task() {
+        auto* tcb = m_policy.pick_next();
+        return (tcb != nullptr) ? tcb : &m_internal_task;
+    }
+
+    /**
+     * \brief Mark a thread as pending and hand it to the scheduling policy
+     * 
+     * \param tcb The thread to make ready
+     */
+    void make_ready(task_control_block* tcb) {
+        tcb->thread_ptr->set_status(thread::status::pending);
+        m_policy.on_ready(tcb);
+    }
+
+    /**
+     * \brief Take a thread off the wait queue it is blocked on, or stop it waiting for a notification, if any, and record
+     *        why it was woken up
+     * 
+     * \param tcb The thread
+     * \param result The reason the thread stopped waiting
+     */
+    void leave_wait_queue(task_control_block* tcb, wait_result result) {
+        if ( tcb->notification == notification_state::waiting ) {
+            tcb->notification = notification_state::none;
+            tcb->wait_status = result;
+        }
+        if ( tcb->waiting_on != nullptr ) {
+            tcb->waiting_on->remove(tcb);
+            tcb->waiting_on = nullptr;
+            tcb->wait_status = result;
+
+            // The owner of the lock may have been inheriting this thread's priority
+            if ( auto* lock = tcb->blocked_on ) {
+                tcb->blocked_on = nullptr;
+                update_priority(lock->owner);
+            }
+        }
+    }
+
+    /**
+     * \brief Record a thread as the owner of a lock
+     * 
+     * \param lock The lock
+     * \param tcb The new owner
+     */
+    void grant_lock(owned_lock& lock, task_control_block* tcb) {
+        lock.owner = tcb;
+        lock.next_held = tcb->held_locks;
+        tcb->held_locks = &lock;
+    }
+
+    /**
+     * \brief Recompute the effective priority of a thread from its base priority, or its throttled priority while its
+     *        budget group is exhausted, and the ceiling and the highest priority waiter of each lock it holds. If the
+     *        thread is itself waiting on a lock, the change is carried along to the owner of that lock and so on down
+     *        the chain until a priority no longer changes.
+     * 
+     * \param tcb The thread to update, may be nullptr
+     */
+    void update_priority(task_control_block* tcb) {
+        while ( tcb != nullptr ) {
+            auto priority = tcb->base_priority;
+            if ( (tcb->budget != nullptr) && tcb->budget->exhausted && (tcb->budget->throttled_priority > priority) ) {
+                priority = tcb->budget->throttled_priority;
+            }
+            for ( auto* lock = tcb->held_locks; lock != nullptr; lock = lock->next_held ) {
+                if ( lock->ceiling < priority ) {
+                    priority = lock->ceiling;
                 }
+                auto* waiter = lock->waiters.front();
+                if ( (waiter != nullptr) && (waiter->priority < priority) ) {
+                    priority = waiter->priority;
+                }
+            }
+            if ( priority == tcb->priority ) {
+                return;
+            }
+            set_effective_priority(tcb, priority);
+            tcb = (tcb->blocked_on != nullptr) ? tcb->blocked_on->owner : nullptr;
+        }
+    }
+
+    /**
+     * \brief Change the effective priority of a thread and requeue it with the scheduling policy, or in the wait queue
+     *        it is blocked on, so that it is ordered by the new priority
+     * 
+     * \param tcb The thread
+     * \param priority The new effective priority
+     */
+    void set_effective_priority(task_control_block* tcb, uint32_t priority) {
+        auto status = tcb->thread_ptr->get_status();
+        bool ready = (tcb != &m_internal_task) && ((status == thread::status::active) || (status == thread::status::pending));
+        if ( ready ) {
+            m_policy.on_block(tcb);
+        }
+        if ( tcb->waiting_on != nullptr ) {
+            tcb->waiting_on->remove(tcb);
+        }
+        tcb->priority = priority;
+        if ( tcb->waiting_on != nullptr ) {
+            tcb->waiting_on->insert(tcb);
+        }
+        if ( ready ) {
+            m_policy.on_ready(tcb);
+        }
+    }
+
+    /**
+     * \brief Switch to the thread chosen by the scheduling policy if it is not the active thread. A ready active thread
+     *        with a preemption threshold is only preempted by a thread with a higher priority than its threshold, or
+     *        than its own effective priority if that is higher. Threads that block are always switched away from.
+     */
+    void preempt_if_outranked() {
+        auto* next = get_next_ready_task();
+        if ( (next != m_active_task) && !is_shielded_from(next) ) {
+            context_switch_to(next);
+        }
+    }
+
+    /**
+     * \brief Check if the active thread's preemption threshold stops another thread from preempting it
+     * 
+     * \param tcb The thread that would preempt the active thread
+     * \retval bool True if the active thread keeps running
+     */
+    bool is_shielded_from(const task_control_block* tcb) const {
+        auto threshold = m_active_task->preemption_threshold;
+        if ( (m_active_task == &m_internal_task) || (threshold == no_preemption_threshold) ) {
+            return false;
+        }
+        auto status = m_active_task->thread_ptr->get_status();
+        if ( (status != thread::status::active) && (status != thread::status::pending) ) {
+            return false;
+        }
+
+        // A thread that has used up its CPU budget loses its shield along with its priority
+        if ( (m_active_task->budget != nullptr) && m_active_task->budget->exhausted ) {
+            return false;
+        }
+        return tcb->priority >= std::min(threshold, m_active_task->priority);
+    }
+
+    /**
+     * \brief Check if a budget group is already in the scheduler's list of budget groups
+     * 
+     * \param budget The budget group
+     * \retval bool True if the group is known
+     */
+    bool is_known_budget(const cpu_budget* budget) const {
+        for ( auto* known = m_budgets; known != nullptr; known = known->next ) {
+            if ( known == budget ) {
+                return true;
             }
         }
+        return false;
+    }
+
+    /**
+     * \brief Recompute the priority of every thread charged to a budget group after it was throttled or replenished
+     * 
+     * \param budget The budget group
+     */
+    void update_budget_priorities(const cpu_budget* budget) {
+        for ( unsigned i = 0; i < m_thread_count; i++ ) {
+            if ( m_task_control_blocks[i].budget == budget ) {
+                update_priority(&m_task_control_blocks[i]);
+            }
+        }
+    }
+
+    /**
+     * \brief Refill every budget group whose replenishment period has ended, and restore the priorities of the
+     *        threads of groups that were throttled
+     * 
+     * \param now The current tick
+     */
+    void replenish_budgets(uint32_t now) {
+        for ( auto* budget = m_budgets; budget != nullptr; budget = budget->next ) {
+            if ( !budget->period_running || !sleep_list::tick_reached(now, budget->replenish_tick) ) {
+                continue;
+            }
+            budget->remaining = budget->budget;
+            budget->period_running = false;
+            if ( budget->exhausted ) {
+                budget->exhausted = false;
+                update_budget_priorities(budget);
+            }
+        }
+    }
+
+    /**
+     * \brief Charge the current tick to the active thread's budget group, and throttle the group's threads if that
+     *        used up the budget
+     * 
+     * \param now The current tick
+     */
+    void charge_budget(uint32_t now) {
+        auto* budget = m_active_task->budget;
+        if ( (m_active_task == &m_internal_task) || (budget == nullptr) || budget->exhausted ) {
+            return;
+        }
+        if ( !budget->period_running ) {
+            budget->period_running = true;
+            budget->replenish_tick = now + budget->period;
+        }
+        if ( budget->remaining > 0 ) {
+            budget->remaining--;
+        }
+        if ( budget->remaining == 0 ) {
+            budget->exhausted = true;
+            budget->overruns++;
+            update_budget_priorities(budget);
+        }
+    }
 
-        // All threads are sleeping so context switch to the internal OS thread
-        context_switch_to(&m_internal_task);
+    /**
+     * \brief Remove the active thread from the ready list and update its status
+     * 
+     * \param status The new (non-runnable) status of the thread
+     */
+    void block_active_task(thread::status status) {
+        if ( m_active_task != &m_internal_task ) {
+            m_policy.on_block(m_active_task);
+        }
+        m_active_task->thread_ptr->set_status(status);
+    }
+
+    /**
+     * \brief Block the active thread until it is woken up, parking it on the sleep list if it has a timeout, and
+     *        switch to the next ready thread
+     * 
+     * \param timeout Max ticks to wait for, or wait_forever
+     */
+    void park_active_task(uint32_t timeout) {
+        if ( timeout == wait_forever ) {
+            block_active_task(thread::status::suspended);
+        } else {
+            m_active_task->wake_tick = m_clock.get_ticks() + timeout;
+            block_active_task(thread::status::sleeping);
+            m_sleep_list.insert(m_active_task);
+        }
+        jump_to_next_pending_task();
     }
 
     system_clock m_clock;
     unsigned m_max_thread_count;
     set_pending_interrupt m_set_pending;
     is_interrupt_pending m_check_pending;
-    uint32_t m_last_tick;
     unsigned m_thread_count;
-    std::unique_ptr<task_control_block[]> m_task_control_blocks;
+    std::span<task_control_block> m_task_control_blocks;
     task_control_block* m_active_task;
     task_control_block* m_pending_task;
     task_control_block m_internal_task;
+    Policy m_policy;
+    sleep_list m_sleep_list;
+    cpu_budget* m_budgets;
+};
+
+//!< Scheduler using the scheduling policy selected for the build
+using scheduler_impl = basic_scheduler_impl<default_scheduling_policy>;
+
+/**
+ * \brief Fixed size table of task control blocks. This is kept as a separate base class so that the table is
+ *        constructed before the scheduler that refers to it
+ *
+ * \tparam MaxThreads Number of task control blocks in the table
+ */
+template <std::size_t MaxThreads>
+struct task_control_block_table {
+    std::array<task_control_block, MaxThreads> m_task_control_block_table = {};
+};
+
+/**
+ * \brief Scheduler with its task control blocks allocated inline. The thread count is fixed at compile time so the
+ *        whole kernel footprint is static and no heap is needed.
+ *
+ * \tparam MaxThreads Max number of threads the scheduler can register
+ * \tparam Policy Scheduling policy
+ */
+template <std::size_t MaxThreads, typename Policy = default_scheduling_policy>
+class static_scheduler : private task_control_block_table<MaxThreads>, public basic_scheduler_impl<Policy> {
+    static_assert(MaxThreads > 0, "static_scheduler must support at least one thread");
+    static_assert(policy_holds_threads<Policy, MaxThreads>(), "static_scheduler has more threads than its policy holds");
+
+  public:
+    using typename basic_scheduler_impl<Policy>::set_pending_interrupt;
+    using typename basic_scheduler_impl<Policy>::is_interrupt_pending;
+
+    /**
+     * \brief Construct a new scheduler
+     *
+     * \param set_pending Function pointer to the function to set a pending context switch interrupt
+     * \param check_pending Function pointer to check if an interrupt is already pending
+     */
+    static_scheduler(set_pending_interrupt set_pending, is_interrupt_pending check_pending)
+        : task_control_block_table<MaxThreads>()
+        , basic_scheduler_impl<Policy>(this->m_task_control_block_table, set_pending, check_pending) { }
+
+    static_scheduler(const static_scheduler&) = delete;
+    static_scheduler& operator=(const static_scheduler&) = delete;
 };
 
 };  // namespace os
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "edf_policy.hpp"
+#include "ready_list.hpp"
+#include "sleep_list.hpp"
+#include "task_control_block.hpp"
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(OS_TIME_SLICE_TICKS)
+//!< Default round-robin time slice in ticks for threads of equal priority. Zero disables time slicing
+#define OS_TIME_SLICE_TICKS 0
+#endif
+
+namespace os
+{
+
+/**
+ * \brief Scheduling policies decide which ready thread runs next. A policy is a template parameter of the scheduler so
+ *        that its hooks are resolved at compile time and inline into the scheduler hot paths. Every policy provides:
+ *          - on_ready(tcb): a thread became ready to run
+ *          - on_block(tcb): a ready thread stopped being ready (blocked, or about to be requeued)
+ *          - pick_next(): the ready thread that should run now, or nullptr if no threads are ready. The active thread
+ *            stays in the ready set while it runs, so it is preempted whenever pick_next returns a different thread
+ *          - on_tick(active, now): called from the tick path with the running thread, which may be requeued
+ *          - on_dispatch(tcb, now): a thread was switched in
+ *        The internal idle thread is never passed to a policy. The earliest deadline first policy lives in
+ *        edf_policy.hpp.
+ */
+
+/**
+ * \brief Check if a policy can hold every thread of a scheduler as ready at once. Policies with a fixed capacity
+ *        declare it as max_ready_threads, and policies without one hold any number of threads.
+ *
+ * \tparam Policy Scheduling policy
+ * \tparam MaxThreads Max number of threads the scheduler can register
+ * \retval bool True if the policy holds MaxThreads ready threads
+ */
+template <typename Policy, std::size_t MaxThreads>
+constexpr bool policy_holds_threads() {
+    if constexpr ( requires { Policy::max_ready_threads; } ) {
+        return MaxThreads <= Policy::max_ready_threads;
+    } else {
+        return true;
+    }
+}
+
+/**
+ * \brief Preemptive fixed priority scheduling. The highest priority ready thread always runs, and threads of equal
+ *        priority run in the order they became ready.
+ */
+class fixed_priority_policy {
+  public:
+    void on_ready(task_control_block* tcb) {
+        m_ready_list.insert(tcb);
+    }
+
+    void on_block(task_control_block* tcb) {
+        m_ready_list.remove(tcb);
+    }
+
+    task_control_block* pick_next() const {
+        return m_ready_list.top();
+    }
+
+    void on_tick(task_control_block* active, uint32_t now) {
+        (void)active;
+        (void)now;
+    }
+
+    void on_dispatch(task_control_block* tcb, uint32_t now) {
+        (void)tcb;
+        (void)now;
+    }
+
+  protected:
+    ready_list<MAX_THREAD_PRIORITIES> m_ready_list;
+};
+
+/**
+ * \brief Fixed priority scheduling with round-robin time slicing among threads of equal priority. When the running
+ *        thread has used up its time slice it is moved behind the other ready threads of its priority.
+ */
+class round_robin_policy : public fixed_priority_policy {
+  public:
+    //!< Default time slice in ticks, zero disables time slicing
+    static constexpr uint32_t default_time_slice = OS_TIME_SLICE_TICKS;
+
+    void on_tick(task_control_block* active, uint32_t now) {
+        if ( (m_time_slice > 0) && sleep_list::tick_reached(now, m_slice_start_tick + m_time_slice) ) {
+            m_ready_list.remove(active);
+            m_ready_list.insert(active);
+            m_slice_start_tick = now;
+        }
+    }
+
+    void on_dispatch(task_control_block* tcb, uint32_t now) {
+        (void)tcb;
+        m_slice_start_tick = now;
+    }
+
+    /**
+     * \brief Set the time slice for threads of equal priority
+     *
+     * \param ticks Ticks a thread runs before rotating behind other ready threads of its priority, or zero to disable
+     */
+    void set_time_slice(uint32_t ticks) {
+        m_time_slice = ticks;
+    }
+
+  private:
+    uint32_t m_time_slice = default_time_slice;
+    uint32_t m_slice_start_tick = 0;
+};
+
+#if !defined(OS_SCHEDULING_POLICY)
+//!< Policy used by the os::scheduler singleton, selected with the OS_SCHEDULING_POLICY CMake option
+#define OS_SCHEDULING_POLICY round_robin_policy
+#endif
+
+using default_scheduling_policy = OS_SCHEDULING_POLICY;
+
+};  // namespace os
@@ -3,11 +3,13 @@
 
 #pragma once
 
+#include "coroutine_wait_list.hpp"
 #include "device_port.hpp"
 #include "interrupt_lock_guard.hpp"
-#include "ring_buffer.hpp"
 #include "scheduler.hpp"
 #include "task_control_block.hpp"
+#include "wait_queue.hpp"
+#include <coroutine>
 #include <cstdint>
 #include <type_traits>
 #include <algorithm>
@@ -23,7 +25,15 @@ class counting_semaphore {
      * \param desired Desired initial resource count
      */
     constexpr explicit counting_semaphore(std::ptrdiff_t desired)
-        : m_scheduler(&scheduler::get())
+        : counting_semaphore(scheduler::get(), desired) { }
+
+    /**
+     * \brief Create a new counting semaphore managed by a specific scheduler
+     * \param scheduler The scheduler that runs the threads using the semaphore
+     * \param desired Desired initial resource count
+     */
+    constexpr counting_semaphore(scheduler_impl& scheduler, std::ptrdiff_t desired)
+        : m_scheduler(&scheduler)
         , m_count(desired) { }
 
     // Default destruction
@@ -33,49 +43,57 @@ class counting_semaphore {
     counting_semaphore(const counting_semaphore&) = delete;
     counting_semaphore& operator=(counting_semaphore&) = delete;
 
-    // Semaphore can be moved
-    counting_semaphore(counting_semaphore&&) = default;
-    counting_semaphore& operator=(counting_semaphore&&) = default;
+    // Semaphore cannot be moved as waiting threads link to its wait queue
+    counting_semaphore(counting_semaphore&&) = delete;
+    counting_semaphore& operator=(counting_semaphore&&) = delete;
 
     /**
      * \brief Atomically increments the internal counter by the value of update (default 1)
      * \note Any suspended threads waiting on the counter will be scheduled to wake up in the order that they were suspended
-     *       (FIFO).
-     * \todo When considering thread priority, think about how to pop a thread by highest priority to awake (min heap)
+     *       (FIFO). A woken thread with a higher priority than the caller preempts it immediately.
      * 
      * \param update Amount to increment the internal count
      */
     void release(std::ptrdiff_t update = 1) {
         os::interrupt_guard guard;
+        release_locked(update);
+    }
+
+    /**
+     * \brief Release the semaphore from inside a critical section that the caller already holds, for kernel objects
+     *        that wake a thread or coroutine as part of a larger update. Interrupts stay disabled throughout.
+     *
+     * \param update Amount to increment the internal count
+     */
+    void release_locked(std::ptrdiff_t update = 1) {
+        // Hand each unit straight to a waiting thread so that it cannot be taken by a thread that never blocked
+        while ( (update > 0) && (m_scheduler->wake_one(m_waiters) != nullptr) ) {
+            update--;
+        }
+        // Then to waiting coroutines, which are resumed by their executor
+        while ( update > 0 ) {
+            auto* waiter = m_coroutine_waiters.pop_front();
+            if ( waiter == nullptr ) {
+                break;
+            }
+            waiter->wake_locked(*waiter);
+            update--;
+        }
         m_count = m_count + update;
         m_count = std::clamp(m_count, static_cast<uint32_t>(0), static_cast<uint32_t>(LeastMaxValue));
-        auto pending = m_suspended_threads.pop_back();
-        if ( pending.has_value() ) {
-            auto* tcb = pending.value();
-            tcb->thread_ptr->set_status(thread::status::pending);
-        }
     }
 
     /**
      * \brief Atomically decrements the counter by one or suspends the calling thread until it can     
      */
     void acquire() {
-        DISABLE_INTERRUPTS();
+        os::interrupt_guard guard;
         if ( m_count > 0 ) {
             //!< TODO: look into figuring this out with exclusive access instructions
             m_count--;
-            ENABLE_INTERRUPTS();            
         } else {
-            // Add the calling thread to the list of threads waiting on this semaphore to be woken up
-            // when the resource becomes available
-            auto *tcb = m_scheduler->get_active_tcb_ptr();
-            m_suspended_threads.push_back(tcb);
-            ENABLE_INTERRUPTS();
-            m_scheduler->suspend_thread();
-            DISABLE_INTERRUPTS();
-            // Thread has now woken up, so decrement the counter and return
-            m_count--;
-            ENABLE_INTERRUPTS();            
+            // Wait for release to hand a unit to this thread. The switch happens once interrupts are re-enabled
+            m_scheduler->block_on(m_waiters);
         }
     }
 
@@ -96,7 +114,8 @@ class counting_semaphore {
 
     /**
      * \brief Try to acquire the semaphore for a set period of time in milliseconds. If not acquired
-     *        immediately, the calling thread is slept for up rel_time_ms
+     *        immediately, the calling thread waits for up to rel_time_ms for a release. The waiting thread is parked
+     *        on the semaphore and on the sleep list, so it is woken exactly once by whichever happens first.
      * 
      * \param rel_time_ms Time to try to acquire for in ms
      * \return bool True if acquired
@@ -107,30 +126,64 @@ class counting_semaphore {
             m_count--;
             ENABLE_INTERRUPTS();
             return true;
-        } else {
-            m_suspended_threads.push_back(m_scheduler->get_active_tcb_ptr());
-
-            // Wait in a loop for up to the total requested time while trying to acquire the resource
-            auto start_tick = m_scheduler->get_elapsed_ticks();
-            uint32_t elapsed_ticks = 0;
-            while ( elapsed_ticks <= rel_time_ms ) {
-                // Re-enable interrupts to allow a context switch
-                ENABLE_INTERRUPTS();
-                m_scheduler->sleep_thread(rel_time_ms - elapsed_ticks);
-
-                // Returned from sleep here via context switch. Either by elapsed time expiring, or from another thread releasing
-                // the resource
-                DISABLE_INTERRUPTS();
-                elapsed_ticks = m_scheduler->get_elapsed_ticks() - start_tick;
-                // Check again if we can acquire the resource
-                if ( try_acquire() ) {
-                    ENABLE_INTERRUPTS();
-                    return true;
-                }
+        }
+        m_scheduler->block_on(m_waiters, rel_time_ms);
+        ENABLE_INTERRUPTS();
+
+        // Running again, either with a unit handed over by release or after the timeout
+        return m_scheduler->get_active_tcb_ptr()->wait_status == wait_result::signaled;
+    }
+
+    /**
+     * \brief Try to acquire the semaphore, waiting until an absolute system tick if it is not available
+     * 
+     * \param timeout_tick System tick to give up at
+     * \return bool True if acquired
+     */
+    [[nodiscard]] bool try_acquire_until(uint32_t timeout_tick) {
+        uint32_t now = m_scheduler->get_elapsed_ticks();
+        return try_acquire_for(sleep_list::tick_reached(now, timeout_tick) ? 0 : timeout_tick - now);
+    }
+
+    /**
+     * \brief Awaitable that acquires the semaphore from a coroutine, suspending the coroutine instead of its thread
+     *        until a unit is handed to it. Threads blocked on the semaphore are handed units before coroutines.
+     */
+    class acquire_awaiter {
+      public:
+        explicit acquire_awaiter(counting_semaphore& semaphore)
+            : m_semaphore(semaphore) { }
+
+        bool await_ready() {
+            return m_semaphore.try_acquire();
+        }
+
+        template <typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> handle) {
+            handle.promise().prepare_waiter(m_waiter, handle);
+            os::interrupt_guard guard;
+            if ( m_semaphore.m_count > 0 ) {
+                m_semaphore.m_count--;
+                return false;
             }
-            ENABLE_INTERRUPTS();
-            return false;
+            m_semaphore.m_coroutine_waiters.push_back(m_waiter);
+            return true;
         }
+
+        void await_resume() { }
+
+      private:
+        counting_semaphore& m_semaphore;
+        coroutine_waiter m_waiter;
+    };
+
+    /**
+     * \brief Acquire the semaphore from a coroutine with co_await
+     * 
+     * \return acquire_awaiter Awaitable that completes once the semaphore is acquired
+     */
+    [[nodiscard]] acquire_awaiter acquire_async() {
+        return acquire_awaiter(*this);
     }
 
     /**
@@ -144,7 +197,8 @@ class counting_semaphore {
 
   private:
     scheduler_impl* m_scheduler;
-    ring_buffer<task_control_block*, MAX_THREAD_COUNT> m_suspended_threads;
+    wait_queue m_waiters;
+    coroutine_wait_list m_coroutine_waiters;
     uint32_t m_count;
 };
 
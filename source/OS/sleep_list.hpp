@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "task_control_block.hpp"
+#include "task_list.hpp"
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief List of sleeping threads ordered by the absolute tick they wake up on. Keeping the list sorted moves the cost
+ *        of ordering into the sleeping thread's context so that the tick handler only has to look at the head of the list.
+ *        Wake ticks are compared with wrapping arithmetic, so a thread can sleep for up to 2^31 - 1 ticks.
+ */
+class sleep_list {
+  public:
+    using list_type = task_list<&task_control_block::timer_link>;
+
+    /**
+     * \brief Check if a tick has been reached, accounting for tick counter rollover
+     *
+     * \param now The current tick
+     * \param tick The tick to compare against
+     * \retval bool True if now is at or past tick
+     */
+    static bool tick_reached(uint32_t now, uint32_t tick) {
+        return static_cast<int32_t>(now - tick) >= 0;
+    }
+
+    /**
+     * \brief Insert a thread in wake tick order. Threads waking up on the same tick stay in FIFO order
+     *
+     * \param tcb The thread to insert. Its wake_tick must already be set
+     */
+    void insert(task_control_block* tcb) {
+        auto* position = m_list.front();
+        while ( (position != nullptr) && tick_reached(tcb->wake_tick, position->wake_tick) ) {
+            position = list_type::next(position);
+        }
+        m_list.insert_before(position, tcb);
+    }
+
+    /**
+     * \brief Remove a thread from the list before its wake tick
+     *
+     * \param tcb The thread to remove, which must currently be in the list
+     */
+    void remove(task_control_block* tcb) {
+        m_list.remove(tcb);
+    }
+
+    /**
+     * \brief Remove the first thread if its wake tick has been reached
+     *
+     * \param now The current tick
+     * \retval task_control_block* The expired thread, or nullptr if no threads are due
+     */
+    task_control_block* pop_expired(uint32_t now) {
+        auto* tcb = m_list.front();
+        if ( (tcb != nullptr) && tick_reached(now, tcb->wake_tick) ) {
+            m_list.remove(tcb);
+            return tcb;
+        }
+        return nullptr;
+    }
+
+    /**
+     * \brief Get the thread that wakes up first
+     *
+     * \retval task_control_block* The first thread or nullptr if no threads are sleeping
+     */
+    task_control_block* front() const {
+        return m_list.front();
+    }
+
+    /**
+     * \brief Check if there are no sleeping threads
+     *
+     * \retval bool True if empty
+     */
+    bool empty() const {
+        return m_list.empty();
+    }
+
+  private:
+    list_type m_list;
+};
+
+};  // namespace os
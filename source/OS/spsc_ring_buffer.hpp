@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+/**
+ * \brief Lock-free single producer, single consumer FIFO ring buffer with no dynamic allocation. One context (for
+ *        example an interrupt handler) pushes and another (for example a thread) pops at the same time without any
+ *        interrupt masking. The producer only writes the head index and the consumer only writes the tail index, and
+ *        each publishes its index with release ordering after touching the slot, so the other side never sees a slot
+ *        before it is ready. Both indices run freely and are masked into the buffer, which is why the capacity must be
+ *        a power of two.
+ *
+ *        Unlike ring_buffer, pushing to a full buffer fails instead of overwriting the oldest item, as the producer
+ *        cannot move the consumer's tail.
+ *
+ * \tparam T Item type
+ * \tparam Capacity Max number of items, must be a power of two
+ */
+template <typename T, std::size_t Capacity>
+class spsc_ring_buffer {
+    static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0), "spsc_ring_buffer capacity must be a power of two");
+    static_assert(std::is_default_constructible_v<T>, "spsc_ring_buffer items must be default constructible");
+
+  public:
+    spsc_ring_buffer() = default;
+
+    //!< Delete copies and moves
+    spsc_ring_buffer(const spsc_ring_buffer& other) = delete;
+    spsc_ring_buffer(spsc_ring_buffer&& other) = delete;
+    spsc_ring_buffer& operator=(const spsc_ring_buffer& other) = delete;
+    spsc_ring_buffer& operator=(spsc_ring_buffer&& other) = delete;
+
+    /**
+     * \brief Push an item to the back of the buffer. Must only be called by the producer.
+     *
+     * \param data The item
+     * \retval bool False if the buffer is full, in which case the item is not pushed
+     */
+    bool push(const T& data) {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if ( head - m_tail.load(std::memory_order_acquire) == Capacity ) {
+            return false;
+        }
+        m_buffer[head & mask] = data;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Push an item to the back of the buffer by moving it. Must only be called by the producer.
+     *
+     * \param data The item
+     * \retval bool False if the buffer is full, in which case the item is not pushed
+     */
+    bool push(T&& data) {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if ( head - m_tail.load(std::memory_order_acquire) == Capacity ) {
+            return false;
+        }
+        m_buffer[head & mask] = std::move(data);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Push as many items of a block as fit to the back of the buffer with at most two copies, and publish them
+     *        to the consumer together. Must only be called by the producer.
+     *
+     * \param data The items, oldest first
+     * \retval std::size_t Number of items pushed, which is less than the block size if the buffer fills up
+     */
+    std::size_t push(std::span<const T> data) {
+        auto head = m_head.load(std::memory_order_relaxed);
+        auto count = std::min(data.size(), Capacity - (head - m_tail.load(std::memory_order_acquire)));
+        auto index = head & mask;
+        auto first = std::min(count, Capacity - index);
+        std::copy(data.begin(), data.begin() + first, m_buffer.begin() + index);
+        std::copy(data.begin() + first, data.begin() + count, m_buffer.begin());
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * \brief Pop the oldest item from the front of the buffer. Must only be called by the consumer.
+     *
+     * \retval std::optional<T> The item, or an empty optional if the buffer is empty
+     */
+    std::optional<T> pop() {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if ( tail == m_head.load(std::memory_order_acquire) ) {
+            return {};
+        }
+        std::optional<T> value{std::move(m_buffer[tail & mask])};
+        m_tail.store(tail + 1, std::memory_order_release);
+        return value;
+    }
+
+    /**
+     * \brief Pop a block of the oldest items from the front of the buffer with at most two copies. Must only be called
+     *        by the consumer.
+     *
+     * \param destination Where to copy the items to
+     * \retval std::size_t Number of items popped, which is less than the destination size if the buffer runs out
+     */
+    std::size_t pop(std::span<T> destination) {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto count = std::min(destination.size(), m_head.load(std::memory_order_acquire) - tail);
+        auto index = tail & mask;
+        auto first = std::min(count, Capacity - index);
+        std::copy(m_buffer.begin() + index, m_buffer.begin() + index + first, destination.begin());
+        std::copy(m_buffer.begin(), m_buffer.begin() + (count - first), destination.begin() + first);
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * \brief Returns the number of items in the buffer. Only a snapshot while the other side is running.
+     *
+     * \retval std::size_t Number of items
+     */
+    std::size_t size() const {
+        auto tail = m_tail.load(std::memory_order_acquire);
+        return m_head.load(std::memory_order_acquire) - tail;
+    }
+
+    /**
+     * \brief Checks if the buffer is empty
+     *
+     * \retval bool True if empty
+     */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * \brief Checks if the buffer is full
+     *
+     * \retval bool True if full
+     */
+    bool full() const {
+        return size() == Capacity;
+    }
+
+    /**
+     * \brief Returns the max number of items the buffer holds
+     *
+     * \retval std::size_t The capacity
+     */
+    static constexpr std::size_t capacity() {
+        return Capacity;
+    }
+
+  private:
+    static constexpr std::size_t mask = Capacity - 1;
+
+    std::array<T, Capacity> m_buffer = {};
+    std::atomic<std::size_t> m_head{0};  //!< Next slot to write, only written by the producer
+    std::atomic<std::size_t> m_tail{0};  //!< Next slot to read, only written by the consumer
+};
@@ -0,0 +1,360 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "blocking_wait.hpp"
+#include "device_port.hpp"
+#include "interrupt_lock_guard.hpp"
+#include "ring_buffer.hpp"
+#include "scheduler.hpp"
+#include "wait_queue.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace os
+{
+
+/**
+ * \brief Fixed capacity buffer of bytes flowing from one writer (a thread or an interrupt, for example a UART receive
+ *        handler) to a reader thread, built on ring_buffer's bulk copies. It is used in one of two ways:
+ *          - As a stream with send and receive. A blocked reader is only woken once the trigger level of bytes has
+ *            arrived, instead of once per byte.
+ *          - As variable length messages with send_message and receive_message. Each message is stored behind a
+ *            length prefix and is written and read whole, so a blocked reader is woken once per complete message.
+ *        The two ways must not be mixed on the same buffer. The try_ calls never block and restore the caller's
+ *        interrupt state on exit, so a handler that runs with interrupts disabled can use them too.
+ *
+ * \tparam Capacity Size of the buffer in bytes, including the length prefixes of messages
+ */
+template <std::size_t Capacity>
+class stream_buffer {
+  public:
+    //!< Wait until the operation can complete, however long that takes
+    static constexpr uint32_t wait_forever = scheduler_impl::wait_forever;
+
+    //!< Type of the length prefix stored in front of every message
+    using message_length = uint16_t;
+
+    //!< Largest message that fits in the buffer
+    static constexpr std::size_t max_message_size =
+        std::min<std::size_t>(Capacity - sizeof(message_length), UINT16_MAX);
+
+    static_assert(Capacity > sizeof(message_length), "stream_buffer must be larger than a message length prefix");
+
+    //!< Outcome of reading a message
+    enum class message_status {
+        received,    //!< The message was copied to the destination and removed from the buffer
+        no_message,  //!< There was no message, or none arrived before the timeout
+        too_large,   //!< The oldest message is larger than the destination and was left in the buffer
+    };
+
+    /**
+     * \brief Result of reading a message
+     */
+    struct message_result {
+        message_status status;
+        std::size_t size;  //!< Size of the message that was read or that is too large, zero if there was no message
+    };
+
+    /**
+     * \brief Create an empty stream buffer managed by the os scheduler
+     *
+     * \param trigger_level Number of bytes that must be available before a blocked reader of the stream wakes up
+     */
+    explicit stream_buffer(std::size_t trigger_level = 1)
+        : stream_buffer(scheduler::get(), trigger_level) { }
+
+    /**
+     * \brief Create an empty stream buffer managed by a specific scheduler
+     *
+     * \param scheduler The scheduler that runs the threads using the buffer
+     * \param trigger_level Number of bytes that must be available before a blocked reader of the stream wakes up
+     */
+    explicit stream_buffer(scheduler_impl& scheduler, std::size_t trigger_level = 1)
+        : m_scheduler(&scheduler)
+        , m_writers(wait_queue::order::priority)
+        , m_readers(wait_queue::order::priority) {
+        set_trigger_level(trigger_level);
+    }
+
+    // Stream buffer cannot be copied or moved as waiting threads link to its wait queues
+    stream_buffer(const stream_buffer&) = delete;
+    stream_buffer& operator=(const stream_buffer&) = delete;
+    stream_buffer(stream_buffer&&) = delete;
+    stream_buffer& operator=(stream_buffer&&) = delete;
+
+    /**
+     * \brief Set the number of bytes that must be available before a blocked reader of the stream wakes up
+     *
+     * \param trigger_level Number of bytes, clamped between one and the capacity
+     */
+    void set_trigger_level(std::size_t trigger_level) {
+        os::interrupt_guard guard;
+        m_trigger_level = std::clamp<std::size_t>(trigger_level, 1, Capacity);
+    }
+
+    /**
+     * \brief Write bytes to the stream, waiting for space whenever the buffer is full
+     *
+     * \param data The bytes
+     * \param timeout Max ticks to wait for space, or wait_forever
+     * \retval std::size_t Number of bytes written, less than the data size if the wait timed out
+     */
+    std::size_t send(std::span<const uint8_t> data, uint32_t timeout = wait_forever) {
+        const uint32_t deadline = m_scheduler->get_elapsed_ticks() + timeout;
+        std::size_t written{0};
+        DISABLE_INTERRUPTS();
+        while ( true ) {
+            written += write_bytes(data.subspan(written));
+            if ( written == data.size() ) {
+                break;
+            }
+            if ( timeout != wait_forever ) {
+                auto now = m_scheduler->get_elapsed_ticks();
+                timeout = sleep_list::tick_reached(now, deadline) ? 0 : deadline - now;
+            }
+            if ( !wait_while(*m_scheduler, m_writers, [this]() { return m_bytes.full(); }, timeout) ) {
+                break;
+            }
+        }
+        ENABLE_INTERRUPTS();
+        return written;
+    }
+
+    /**
+     * \brief Write as many bytes to the stream as fit. Never blocks, so it is safe to call from an interrupt.
+     *
+     * \param data The bytes
+     * \retval std::size_t Number of bytes written
+     */
+    std::size_t try_send(std::span<const uint8_t> data) {
+        os::interrupt_restore_guard guard;
+        return write_bytes(data);
+    }
+
+    /**
+     * \brief Read bytes from the stream, waiting until at least the trigger level of bytes is available. If the wait
+     *        times out, the bytes that did arrive are read.
+     *
+     * \param destination Where to copy the bytes to
+     * \param timeout Max ticks to wait for, or wait_forever
+     * \retval std::size_t Number of bytes read, up to the destination size
+     */
+    std::size_t receive(std::span<uint8_t> destination, uint32_t timeout = wait_forever) {
+        DISABLE_INTERRUPTS();
+        (void)wait_while(*m_scheduler, m_readers, [this]() { return m_bytes.size() < m_trigger_level; }, timeout);
+        auto count = read_bytes(destination);
+        ENABLE_INTERRUPTS();
+        return count;
+    }
+
+    /**
+     * \brief Read the bytes that are available. Never blocks, so it is safe to call from an interrupt.
+     *
+     * \param destination Where to copy the bytes to
+     * \retval std::size_t Number of bytes read, up to the destination size
+     */
+    std::size_t try_receive(std::span<uint8_t> destination) {
+        os::interrupt_restore_guard guard;
+        return read_bytes(destination);
+    }
+
+    /**
+     * \brief Write a whole message, waiting until there is space for it and its length prefix
+     *
+     * \param message The message, from one to max_message_size bytes
+     * \param timeout Max ticks to wait for space, or wait_forever
+     * \retval bool True if written, false if the message is empty or too large, or the wait timed out
+     */
+    bool send_message(std::span<const uint8_t> message, uint32_t timeout = wait_forever) {
+        if ( !valid_message(message) ) {
+            return false;
+        }
+        DISABLE_INTERRUPTS();
+        if ( !wait_while(*m_scheduler, m_writers, [this, &message]() { return !message_fits(message); }, timeout) ) {
+            ENABLE_INTERRUPTS();
+            return false;
+        }
+        write_message(message);
+        ENABLE_INTERRUPTS();
+        return true;
+    }
+
+    /**
+     * \brief Write a whole message if there is space for it. Never blocks, so it is safe to call from an interrupt.
+     *
+     * \param message The message, from one to max_message_size bytes
+     * \retval bool True if written, false if the message is empty or too large, or there is no space for it
+     */
+    bool try_send_message(std::span<const uint8_t> message) {
+        os::interrupt_restore_guard guard;
+        if ( !valid_message(message) || !message_fits(message) ) {
+            return false;
+        }
+        write_message(message);
+        return true;
+    }
+
+    /**
+     * \brief Read the oldest message, waiting until a whole message is available. A message larger than the
+     *        destination is left in the buffer and reported as too_large with its size, so the caller can read it into
+     *        a larger destination or drop it with discard_message.
+     *
+     * \param destination Where to copy the message to
+     * \param timeout Max ticks to wait for, or wait_forever
+     * \retval message_result Whether the message was read, none arrived in time, or it does not fit
+     */
+    message_result receive_message(std::span<uint8_t> destination, uint32_t timeout = wait_forever) {
+        DISABLE_INTERRUPTS();
+        message_result result{message_status::no_message, 0};
+        if ( wait_while(*m_scheduler, m_readers, [this]() { return m_bytes.empty(); }, timeout) ) {
+            result = read_message(destination);
+        }
+        ENABLE_INTERRUPTS();
+        return result;
+    }
+
+    /**
+     * \brief Read the oldest message if there is one. Never blocks, so it is safe to call from an interrupt.
+     *
+     * \param destination Where to copy the message to
+     * \retval message_result Whether the message was read, there was none, or it does not fit
+     */
+    message_result try_receive_message(std::span<uint8_t> destination) {
+        os::interrupt_restore_guard guard;
+        if ( m_bytes.empty() ) {
+            return {message_status::no_message, 0};
+        }
+        return read_message(destination);
+    }
+
+    /**
+     * \brief Drop the oldest message without reading it, for example one that is too large for any destination
+     *
+     * \retval bool False if there is no message
+     */
+    bool discard_message() {
+        os::interrupt_restore_guard guard;
+        if ( m_bytes.empty() ) {
+            return false;
+        }
+        m_bytes.commit_read(sizeof(message_length) + peek_length());
+        m_scheduler->wake_one(m_writers);
+        return true;
+    }
+
+    /**
+     * \brief Get the size of the oldest message without reading it
+     *
+     * \retval std::size_t Size of the message, or zero if there is none
+     */
+    std::size_t next_message_size() {
+        os::interrupt_restore_guard guard;
+        return m_bytes.empty() ? 0 : peek_length();
+    }
+
+    /**
+     * \brief Get the number of bytes in the buffer, including message length prefixes
+     *
+     * \retval std::size_t Number of bytes
+     */
+    std::size_t size() const {
+        return m_bytes.size();
+    }
+
+    /**
+     * \brief Checks if the buffer is empty
+     *
+     * \retval bool True if empty
+     */
+    bool empty() const {
+        return m_bytes.empty();
+    }
+
+  private:
+    /**
+     * \brief Copy as many bytes as fit into the buffer, and wake a blocked reader once the trigger level is reached.
+     *        Must be called with interrupts disabled.
+     */
+    std::size_t write_bytes(std::span<const uint8_t> data) {
+        auto count = std::min(data.size(), Capacity - m_bytes.size());
+        m_bytes.push_back(data.first(count));
+        if ( m_bytes.size() >= m_trigger_level ) {
+            m_scheduler->wake_one(m_readers);
+        }
+        return count;
+    }
+
+    /**
+     * \brief Copy bytes out of the buffer, and wake a blocked writer now that there is space. Must be called with
+     *        interrupts disabled.
+     */
+    std::size_t read_bytes(std::span<uint8_t> destination) {
+        auto count = m_bytes.pop_back(destination);
+        if ( count > 0 ) {
+            m_scheduler->wake_one(m_writers);
+        }
+        return count;
+    }
+
+    static bool valid_message(std::span<const uint8_t> message) {
+        return !message.empty() && (message.size() <= max_message_size);
+    }
+
+    bool message_fits(std::span<const uint8_t> message) const {
+        return Capacity - m_bytes.size() >= message.size() + sizeof(message_length);
+    }
+
+    /**
+     * \brief Copy a message and its length prefix into the buffer and wake a blocked reader. Must be called with
+     *        interrupts disabled and enough space.
+     */
+    void write_message(std::span<const uint8_t> message) {
+        const auto length = static_cast<message_length>(message.size());
+        const uint8_t prefix[sizeof(message_length)] = {static_cast<uint8_t>(length & 0xFFu),
+                                                        static_cast<uint8_t>(length >> 8u)};
+        m_bytes.push_back(std::span<const uint8_t>(prefix));
+        m_bytes.push_back(message);
+        m_scheduler->wake_one(m_readers);
+    }
+
+    /**
+     * \brief Read the length prefix of the oldest message, which may wrap around the end of the buffer. Must be called
+     *        with interrupts disabled and at least one message in the buffer.
+     */
+    std::size_t peek_length() {
+        auto [first, second] = m_bytes.readable_regions();
+        uint8_t prefix[sizeof(message_length)];
+        for ( std::size_t i = 0; i < sizeof(message_length); i++ ) {
+            prefix[i] = (i < first.size()) ? first[i] : second[i - first.size()];
+        }
+        return static_cast<std::size_t>(prefix[0]) | (static_cast<std::size_t>(prefix[1]) << 8u);
+    }
+
+    /**
+     * \brief Copy the oldest message out of the buffer if it fits in the destination. Must be called with interrupts
+     *        disabled and at least one message in the buffer.
+     */
+    message_result read_message(std::span<uint8_t> destination) {
+        auto length = peek_length();
+        if ( length > destination.size() ) {
+            return {message_status::too_large, length};
+        }
+        m_bytes.commit_read(sizeof(message_length));
+        m_bytes.pop_back(destination.first(length));
+        m_scheduler->wake_one(m_writers);
+        return {message_status::received, length};
+    }
+
+    scheduler_impl* m_scheduler;
+    wait_queue m_writers;
+    wait_queue m_readers;
+    ring_buffer<uint8_t, Capacity> m_bytes;
+    std::size_t m_trigger_level{1};
+};
+
+};  // namespace os
@@ -8,6 +8,49 @@
 namespace os
 {
 
+struct task_control_block;
+struct owned_lock;
+struct cpu_budget;
+class wait_queue;
+
+/**
+ * \brief Intrusive links used to place a task control block into a task_list without any allocation
+ */
+struct task_link {
+    task_control_block* next;
+    task_control_block* prev;
+};
+
+/**
+ * \brief Outcome of the last time a thread blocked on a wait queue
+ */
+enum class wait_result : unsigned {
+    none = 0,     //!< The thread has not been woken up yet
+    signaled,     //!< Woken up by the object it was waiting on
+    timed_out,    //!< The wait timed out before the object was signaled
+    interrupted,  //!< Resumed directly by the scheduler without being signaled
+};
+
+/**
+ * \brief State of the direct-to-thread notification held in a task control block
+ */
+enum class notification_state : unsigned {
+    none = 0,  //!< No notification is pending and the thread is not waiting for one
+    waiting,   //!< The thread is blocked waiting for a notification
+    pending,   //!< The thread has been notified and has not taken the notification yet
+};
+
+/**
+ * \brief How notifying a thread updates its notification value
+ */
+enum class notify_action : unsigned {
+    no_action = 0,       //!< Leave the value unchanged and only mark the notification pending
+    increment,           //!< Add one to the value, using it as a lightweight counting semaphore
+    set_bits,            //!< Bitwise or the value in, using it as a lightweight event group
+    overwrite,           //!< Replace the value, even if the previous one was not taken yet
+    overwrite_if_empty,  //!< Replace the value only if no notification is pending, using it as a one item mailbox
+};
+
 /**
  * \brief Task control block structure
  */
@@ -15,6 +58,26 @@ struct task_control_block {
     uint32_t* active_stack_pointer;
     task_control_block* next;
     thread* thread_ptr;
-    int32_t suspended_ticks_remaining;
+    uint32_t wake_tick;
+    uint32_t priority;       //!< Effective priority, including any priority inherited through held locks
+    uint32_t base_priority;  //!< Priority the thread was registered with
+    task_link ready_link;
+    task_link timer_link;
+    task_link wait_link;
+    wait_queue* waiting_on;
+    wait_result wait_status;
+    owned_lock* held_locks;  //!< Locks owned by the thread, most recently acquired first
+    owned_lock* blocked_on;  //!< Lock the thread is waiting to acquire, if any
+    uint32_t period;             //!< Ticks between job releases of a periodic thread, zero if not periodic
+    uint32_t relative_deadline;  //!< Ticks after each release that the job must finish by, zero for no deadline
+    uint32_t release_tick;       //!< Tick the current job was released on
+    uint32_t absolute_deadline;  //!< Tick the current job must finish by
+    uint32_t deadline_misses;    //!< Number of jobs that finished after their deadline
+    bool deadline_missed;        //!< The current job has already been counted as a deadline miss
+    uint32_t heap_index;         //!< Position in the ready heap of heap based scheduling policies
+    cpu_budget* budget;          //!< CPU budget group the thread is charged to, if any
+    uint32_t preemption_threshold;  //!< Only threads with a higher priority than this may preempt the running thread
+    uint32_t notification_value;      //!< Value sent to the thread with direct-to-thread notifications
+    notification_state notification;  //!< Whether a notification is pending or the thread is waiting for one
 };
-};  // namespace os
\ No newline at end of file
+};  // namespace os
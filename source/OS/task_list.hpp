@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "task_control_block.hpp"
+
+namespace os
+{
+
+/**
+ * \brief Intrusive doubly linked list of task control blocks. The links live inside the task control block itself
+ *        so that inserting and removing a task is constant time and does not require any storage in the list.
+ *
+ * \tparam Link Pointer to the task_link member of the task control block that this list threads through
+ */
+template <task_link task_control_block::*Link>
+class task_list {
+  public:
+    /**
+     * \brief Check if the list is empty
+     *
+     * \retval bool True if there are no tasks in the list
+     */
+    bool empty() const {
+        return m_head == nullptr;
+    }
+
+    /**
+     * \brief Get the first task in the list
+     *
+     * \retval task_control_block* First task or nullptr if the list is empty
+     */
+    task_control_block* front() const {
+        return m_head;
+    }
+
+    /**
+     * \brief Get the last task in the list
+     *
+     * \retval task_control_block* Last task or nullptr if the list is empty
+     */
+    task_control_block* back() const {
+        return m_tail;
+    }
+
+    /**
+     * \brief Get the task after a task in the list
+     *
+     * \param tcb The task currently in the list
+     * \retval task_control_block* The next task or nullptr if tcb is the last task
+     */
+    static task_control_block* next(task_control_block* tcb) {
+        return (tcb->*Link).next;
+    }
+
+    /**
+     * \brief Add a task to the end of the list
+     *
+     * \param tcb The task to add
+     */
+    void push_back(task_control_block* tcb) {
+        (tcb->*Link).next = nullptr;
+        (tcb->*Link).prev = m_tail;
+        if ( m_tail != nullptr ) {
+            (m_tail->*Link).next = tcb;
+        } else {
+            m_head = tcb;
+        }
+        m_tail = tcb;
+    }
+
+    /**
+     * \brief Add a task to the front of the list
+     *
+     * \param tcb The task to add
+     */
+    void push_front(task_control_block* tcb) {
+        (tcb->*Link).prev = nullptr;
+        (tcb->*Link).next = m_head;
+        if ( m_head != nullptr ) {
+            (m_head->*Link).prev = tcb;
+        } else {
+            m_tail = tcb;
+        }
+        m_head = tcb;
+    }
+
+    /**
+     * \brief Insert a task into the list directly before another task
+     *
+     * \param position The task to insert before, or nullptr to insert at the end of the list
+     * \param tcb The task to insert
+     */
+    void insert_before(task_control_block* position, task_control_block* tcb) {
+        if ( position == nullptr ) {
+            push_back(tcb);
+            return;
+        }
+        auto* prev = (position->*Link).prev;
+        (tcb->*Link).next = position;
+        (tcb->*Link).prev = prev;
+        (position->*Link).prev = tcb;
+        if ( prev != nullptr ) {
+            (prev->*Link).next = tcb;
+        } else {
+            m_head = tcb;
+        }
+    }
+
+    /**
+     * \brief Remove a task from the list. The task must currently be in this list
+     *
+     * \param tcb The task to remove
+     */
+    void remove(task_control_block* tcb) {
+        auto& link = tcb->*Link;
+        if ( link.prev != nullptr ) {
+            (link.prev->*Link).next = link.next;
+        } else {
+            m_head = link.next;
+        }
+        if ( link.next != nullptr ) {
+            (link.next->*Link).prev = link.prev;
+        } else {
+            m_tail = link.prev;
+        }
+        link.next = nullptr;
+        link.prev = nullptr;
+    }
+
+    /**
+     * \brief Remove the first task from the list
+     *
+     * \retval task_control_block* The removed task or nullptr if the list was empty
+     */
+    task_control_block* pop_front() {
+        auto* tcb = m_head;
+        if ( tcb != nullptr ) {
+            remove(tcb);
+        }
+        return tcb;
+    }
+
+  private:
+    task_control_block* m_head = nullptr;
+    task_control_block* m_tail = nullptr;
+};
+
+};  // namespace os
@@ -7,16 +7,18 @@
 
 namespace os
 {
-constexpr uint32_t CONTEXT_STACK_SIZE  = 49ul;       //!< Number of default saved stack registers
+constexpr uint32_t CONTEXT_STACK_SIZE  = sizeof(thread::register_context) / sizeof(uint32_t); //!< Number of default saved stack registers
 constexpr uint32_t PSR_THUMB_MODE      = 0x01000000; //!< set PSR register to THUMB
+constexpr uint32_t EXC_RETURN_THREAD   = 0xFFFFFFFD; //!< Return to thread mode on the PSP with a basic (non-FPU) frame
 
 
-thread::thread(task_pointer task_ptr, uint32_t id, uint32_t* stack_ptr, uint32_t stack_size) 
+thread::thread(task_pointer task_ptr, uint32_t id, uint32_t* stack_ptr, uint32_t stack_size, uint32_t priority) 
 : task_ptr(task_ptr)
 , id(id)
 , stack_top_ptr(stack_ptr)
 , stack_ptr(stack_ptr)
 , stack_size(stack_size)
+, priority(priority)
 , task_status(status::pending) {
     // Initialize the threads stack with some setup values
     register_context* task_context = reinterpret_cast<register_context*>(&stack_ptr[stack_size - CONTEXT_STACK_SIZE]);
@@ -24,6 +26,9 @@ thread::thread(task_pointer task_ptr, uint32_t id, uint32_t* stack_ptr, uint32_t
     // Set the task to run in thumb mode
     task_context->psr = PSR_THUMB_MODE;
 
+    // Threads start without any FPU context, so the first switch in restores the short frame
+    task_context->exc_return = EXC_RETURN_THREAD;
+
     // set the program counter to the function pointer for the thread    
     task_context->pc = static_cast<uint32_t>(reinterpret_cast<std::uintptr_t>(task_ptr));
 
@@ -41,9 +46,6 @@ thread::thread(task_pointer task_ptr, uint32_t id, uint32_t* stack_ptr, uint32_t
     task_context->r10 = 10;
     task_context->r11 = 11;
     task_context->r12 = 12;
-    task_context->fpu[1] = 0x1234;
-    task_context->fpu[2] = 0x5678;
-    task_context->fpscr = 0x00;
 
     // Set the initial value of the active stack pointer to the fake context added above.
     // When the thread is unsuspended, the processor will restore the saved context     
@@ -67,6 +69,11 @@ uint32_t thread::get_id() const {
     return id;
 }
 
+// Get the thread priority
+uint32_t thread::get_priority() const {
+    return priority;
+}
+
 // Get the stack pointer
 uint32_t* thread::get_stack_ptr(){
     return stack_ptr;
@@ -14,6 +14,9 @@ class thread {
      * \brief Contains the packed ordering of the processor register state during context switches.
      *        This is super helpful for debugging as you can pre-fill a thread's context with a custom
      *        default register state.
+     * \note This is the short (integer only) frame. Threads that have used the FPU additionally have
+     *       S16-S31 saved between exc_return and r0, and S0-S15 + FPSCR stacked lazily by the hardware
+     *       after psr. The saved exc_return value tells the context switch which frame a thread has.
      */
     struct register_context {
         uint32_t r4;
@@ -24,8 +27,7 @@ class thread {
         uint32_t r9;
         uint32_t r10;
         uint32_t r11;
-        uint32_t fpu[32];
-        uint32_t fpscr;
+        uint32_t exc_return;
         uint32_t r0;
         uint32_t r1;
         uint32_t r2;
@@ -46,6 +48,9 @@ class thread {
 
     using task_pointer = void (*)();
 
+    //!< Priority zero is the highest priority. Threads default to the lowest priority level
+    static constexpr uint32_t lowest_priority = MAX_THREAD_PRIORITIES - 1;
+
     /**
      * \brief Construct a new Thread object
      * \todo I would like to make this more generic so that any invokable can be passed in like a lambda, etc.
@@ -54,8 +59,9 @@ class thread {
      * \param id thread id
      * \param stack_ptr pointer to the thread stack
      * \param stack_size size of the threads stack
+     * \param priority scheduling priority of the thread (zero is highest)
      */
-    thread(task_pointer task_ptr, uint32_t id, uint32_t* stack_ptr, uint32_t stack_size);
+    thread(task_pointer task_ptr, uint32_t id, uint32_t* stack_ptr, uint32_t stack_size, uint32_t priority = lowest_priority);
 
     /**
      * \brief Set the thread's status
@@ -84,6 +90,13 @@ class thread {
      * \retval uint32_t thread id
      */
     uint32_t get_id() const;
+
+    /**
+     * \brief Get the thread priority
+     * 
+     * \retval uint32_t thread priority
+     */
+    uint32_t get_priority() const;
   
   private:
     const task_pointer task_ptr;    
@@ -91,6 +104,7 @@ class thread {
     uint32_t* const stack_top_ptr;
     uint32_t* stack_ptr;
     const uint32_t stack_size;
+    const uint32_t priority;
     status task_status;
 };
 
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+#include "task_control_block.hpp"
+#include "task_list.hpp"
+
+namespace os
+{
+
+/**
+ * \brief Queue of threads blocked on a synchronization object. The queue is threaded through the wait_link of each
+ *        task control block, so a sync object only pays for a list head no matter how many threads can wait on it.
+ *        Threads are blocked and woken through the scheduler, see scheduler_impl::block_on and scheduler_impl::wake_one.
+ */
+class wait_queue {
+  public:
+    using list_type = task_list<&task_control_block::wait_link>;
+
+    //!< Order that waiting threads are woken up in
+    enum class order : unsigned {
+        fifo = 0,  //!< First thread to block is the first to wake
+        priority,  //!< Highest priority thread wakes first, FIFO among threads with the same priority
+    };
+
+    /**
+     * \brief Create a new empty wait queue
+     *
+     * \param ordering Order that waiting threads are woken up in
+     */
+    constexpr explicit wait_queue(order ordering = order::fifo)
+        : m_order(ordering) { }
+
+    // Threads link directly to the queue, so it cannot be copied
+    wait_queue(const wait_queue&) = delete;
+    wait_queue& operator=(const wait_queue&) = delete;
+
+    /**
+     * \brief Check if no threads are waiting
+     *
+     * \retval bool True if the queue is empty
+     */
+    bool empty() const {
+        return m_waiters.empty();
+    }
+
+    /**
+     * \brief Get the thread that will be woken up next
+     *
+     * \retval task_control_block* The next thread or nullptr if the queue is empty
+     */
+    task_control_block* front() const {
+        return m_waiters.front();
+    }
+
+    /**
+     * \brief Add a thread to the queue according to the queue order
+     *
+     * \param tcb The thread to add
+     */
+    void insert(task_control_block* tcb) {
+        if ( m_order == order::fifo ) {
+            m_waiters.push_back(tcb);
+            return;
+        }
+        auto* position = m_waiters.front();
+        while ( (position != nullptr) && (position->priority <= tcb->priority) ) {
+            position = list_type::next(position);
+        }
+        m_waiters.insert_before(position, tcb);
+    }
+
+    /**
+     * \brief Remove a thread from the queue
+     *
+     * \param tcb The thread to remove, which must currently be in the queue
+     */
+    void remove(task_control_block* tcb) {
+        m_waiters.remove(tcb);
+    }
+
+  private:
+    list_type m_waiters;
+    order m_order;
+};
+
+};  // namespace os
@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "device_port.hpp"
+#include "interrupt_lock_guard.hpp"
+#include "scheduler.hpp"
+#include "semaphore.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace os
+{
+
+/**
+ * \brief Queue of deferred work that interrupt handlers hand off to a worker thread. Posting is lock-free and O(1), so
+ *        an interrupt handler only records what has to be done and returns, and the heavy processing runs in thread
+ *        context at the worker thread's priority. Any number of interrupts (and threads) may post concurrently, even
+ *        when they preempt each other, while a single worker thread drains the queue in batches.
+ *
+ *        Each slot carries a sequence number that tells producers and the consumer whose turn it is to use the slot,
+ *        so a producer claims a slot with one compare-and-swap and never waits for another producer.
+ *
+ * \tparam Capacity Number of work items that can be queued, must be a power of two
+ */
+template <std::size_t Capacity>
+class work_queue {
+    static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0), "work_queue capacity must be a power of two");
+
+  public:
+    //!< Function that does the deferred work
+    using work_function = void (*)(void* argument);
+
+    //!< Default number of items the worker handles before letting other threads of its priority run
+    static constexpr std::size_t default_batch_size = 8;
+
+    /**
+     * \brief Create a work queue managed by the os scheduler
+     */
+    work_queue()
+        : work_queue(scheduler::get()) { }
+
+    /**
+     * \brief Create a work queue managed by a specific scheduler
+     *
+     * \param scheduler The scheduler that runs the worker thread
+     * \param batch_size Number of items the worker handles before letting other threads of its priority run
+     */
+    explicit work_queue(scheduler_impl& scheduler, std::size_t batch_size = default_batch_size)
+        : m_scheduler(&scheduler)
+        , m_wakeup(scheduler, 0)
+        , m_batch_size(batch_size) {
+        for ( std::size_t i = 0; i < Capacity; i++ ) {
+            m_slots[i].sequence.store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    // Work queue cannot be copied or moved as the worker thread waits on it
+    work_queue(const work_queue&) = delete;
+    work_queue& operator=(const work_queue&) = delete;
+
+    /**
+     * \brief Queue work for the worker thread. Safe to call from interrupts and never blocks. Waking the worker leaves
+     *        the caller's interrupt state as it was, so it may also be called with interrupts disabled.
+     *
+     * \param function Function that does the work
+     * \param argument Argument passed to the function
+     * \retval bool False if the queue is full, in which case the work is dropped and counted as an overflow
+     */
+    bool post(work_function function, void* argument = nullptr) {
+        auto position = m_tail.load(std::memory_order_relaxed);
+        slot* target;
+        while ( true ) {
+            target = &m_slots[position & mask];
+            auto sequence = target->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<int32_t>(sequence - position);
+            if ( difference == 0 ) {
+                // The slot is free for this position, so try to claim it
+                if ( m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed) ) {
+                    break;
+                }
+            } else if ( difference < 0 ) {
+                // The slot still holds work from the previous lap, so the queue is full
+                m_overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                // Another producer claimed the position first
+                position = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        target->function = function;
+        target->argument = argument;
+        target->sequence.store(position + 1, std::memory_order_release);
+
+        // Only the first post since the worker last woke up needs to signal it
+        if ( !m_wakeup_pending.exchange(true, std::memory_order_acq_rel) ) {
+            os::interrupt_restore_guard guard;
+            m_wakeup.release_locked();
+        }
+        return true;
+    }
+
+    /**
+     * \brief Run up to a number of queued work items. Must only be called from the worker thread.
+     *
+     * \param max_items Max number of items to run
+     * \retval std::size_t Number of items that were run
+     */
+    std::size_t drain(std::size_t max_items) {
+        std::size_t count{0};
+        while ( count < max_items ) {
+            auto& target = m_slots[m_head & mask];
+            auto sequence = target.sequence.load(std::memory_order_acquire);
+            if ( static_cast<int32_t>(sequence - (m_head + 1)) < 0 ) {
+                // Empty, or the next item is still being written by an interrupted producer
+                break;
+            }
+            auto function = target.function;
+            auto argument = target.argument;
+            target.sequence.store(m_head + Capacity, std::memory_order_release);
+            m_head++;
+            function(argument);
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * \brief Run the worker forever. Call this from the task function of the worker thread. The worker sleeps until
+     *        work is posted, and yields to other threads of its priority between full batches.
+     */
+    [[noreturn]] void run() {
+        while ( true ) {
+            m_wakeup.acquire();
+            m_wakeup_pending.store(false, std::memory_order_release);
+            while ( drain(m_batch_size) == m_batch_size ) {
+                DISABLE_INTERRUPTS();
+                m_scheduler->yield_thread();
+                ENABLE_INTERRUPTS();
+            }
+        }
+    }
+
+    /**
+     * \brief Get the number of work items that were dropped because the queue was full
+     *
+     * \retval uint32_t Number of overflows
+     */
+    uint32_t get_overflow_count() const {
+        return m_overflows.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr uint32_t mask = static_cast<uint32_t>(Capacity - 1);
+
+    struct slot {
+        std::atomic<uint32_t> sequence;
+        work_function function;
+        void* argument;
+    };
+
+    scheduler_impl* m_scheduler;
+    binary_semaphore m_wakeup;
+    std::size_t m_batch_size;
+    std::array<slot, Capacity> m_slots = {};
+    std::atomic<uint32_t> m_tail{0};
+    uint32_t m_head{0};
+    std::atomic<bool> m_wakeup_pending{false};
+    std::atomic<uint32_t> m_overflows{0};
+};
+
+};  // namespace os
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "coroutine.hpp"
+#include "mutex.hpp"
+#include "semaphore.hpp"
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 2;
+
+/************************************ Local Functions ********************************************/
+static os::task<int> add(int a, int b) {
+    co_return a + b;
+}
+
+static os::task<void> sum_into(int& result) {
+    result = *co_await add(1, 2);
+    result += *co_await add(3, 4);
+}
+
+static os::task<void> set_flag(bool& flag) {
+    flag = true;
+    co_return;
+}
+
+static os::task<void> await_without_frames(std::optional<int>& sum, bool& flag_task_ran, bool& flag, bool& finished) {
+    sum = co_await add(1, 2);
+    flag_task_ran = co_await set_flag(flag);
+    finished = true;
+}
+
+static os::task<void> sleep_then_record(uint32_t ticks, std::vector<uint32_t>& log, os::scheduler_impl& scheduler) {
+    co_await os::this_coroutine::sleep_for_msec(ticks);
+    log.push_back(scheduler.get_elapsed_ticks());
+}
+
+static os::task<void> acquire_then_record(os::binary_semaphore& semaphore, int& acquired) {
+    co_await semaphore.acquire_async();
+    acquired++;
+}
+
+static os::task<void> locked_section(os::mutex& mutex, uint32_t hold_ticks, std::vector<int>& log, int id) {
+    co_await mutex.lock_async();
+    log.push_back(id);
+    co_await os::this_coroutine::sleep_for_msec(hold_ticks);
+    log.push_back(-id);
+    mutex.unlock();
+}
+
+static os::task<void> blink(uint32_t period, unsigned count, unsigned& toggles) {
+    for ( unsigned i = 0; i < count; i++ ) {
+        co_await os::this_coroutine::sleep_for_msec(period);
+        toggles++;
+    }
+}
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for coroutine tasks. The executor thread is the active thread, and each test drives the executor
+*        by calling poll as the executor thread would.
+*/
+class CoroutineTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        internal_thread = make_internal_thread(internal_stack);
+        executor_thread = make_thread(1, executor_stack);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(executor_thread.get());
+        scheduler->select_initial_task();
+        executor = std::make_unique<os::coroutine_executor>(*scheduler);
+        pending_irq = false;
+    }
+
+    void TearDown(void) override {
+        executor.reset();
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t executor_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> executor_thread;
+    std::unique_ptr<os::coroutine_executor> executor;
+
+    void tick(uint32_t ticks) {
+        scheduler->update_system_ticks(ticks);
+        scheduler->run();
+    }
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(CoroutineTests, test_spawned_task_runs_on_poll) {
+    int result = 0;
+    ASSERT_TRUE(executor->spawn(sum_into(result)));
+    ASSERT_EQ(0, result);
+    ASSERT_EQ(os::scheduler_impl::wait_forever, executor->poll());
+    ASSERT_EQ(10, result);
+    ASSERT_EQ(0, os::coroutine_frames.in_use());
+}
+
+TEST_F(CoroutineTests, test_sleeping_coroutine_resumes_when_due) {
+    std::vector<uint32_t> log;
+    executor->spawn(sleep_then_record(10, log, *scheduler));
+    executor->spawn(sleep_then_record(5, log, *scheduler));
+    ASSERT_EQ(5, executor->poll());
+    tick(4);
+    ASSERT_EQ(1, executor->poll());
+    ASSERT_TRUE(log.empty());
+    tick(1);
+    ASSERT_EQ(5, executor->poll());
+    ASSERT_EQ(std::vector<uint32_t>({5}), log);
+    tick(5);
+    ASSERT_EQ(os::scheduler_impl::wait_forever, executor->poll());
+    ASSERT_EQ(std::vector<uint32_t>({5, 10}), log);
+}
+
+TEST_F(CoroutineTests, test_semaphore_release_resumes_waiting_coroutine) {
+    os::binary_semaphore semaphore(*scheduler, 0);
+    int acquired = 0;
+    executor->spawn(acquire_then_record(semaphore, acquired));
+    executor->spawn(acquire_then_record(semaphore, acquired));
+    executor->poll();
+    ASSERT_EQ(0, acquired);
+
+    // Each unit is handed to one waiting coroutine
+    semaphore.release();
+    executor->poll();
+    ASSERT_EQ(1, acquired);
+    semaphore.release();
+    executor->poll();
+    ASSERT_EQ(2, acquired);
+    ASSERT_FALSE(semaphore.try_acquire());
+}
+
+TEST_F(CoroutineTests, test_available_semaphore_does_not_suspend) {
+    os::binary_semaphore semaphore(*scheduler, 1);
+    int acquired = 0;
+    executor->spawn(acquire_then_record(semaphore, acquired));
+    executor->poll();
+    ASSERT_EQ(1, acquired);
+}
+
+TEST_F(CoroutineTests, test_mutex_is_handed_between_coroutines) {
+    os::mutex mutex(*scheduler);
+    std::vector<int> log;
+    executor->spawn(locked_section(mutex, 2, log, 1));
+    executor->spawn(locked_section(mutex, 2, log, 2));
+    executor->poll();
+    ASSERT_EQ(std::vector<int>({1}), log);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), mutex.owner());
+
+    tick(2);
+    executor->poll();
+    ASSERT_EQ(std::vector<int>({1, -1, 2}), log);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), mutex.owner());
+
+    tick(2);
+    executor->poll();
+    ASSERT_EQ(std::vector<int>({1, -1, 2, -2}), log);
+    ASSERT_EQ(nullptr, mutex.owner());
+}
+
+TEST_F(CoroutineTests, test_waking_a_coroutine_keeps_the_critical_section_whole) {
+    os::binary_semaphore semaphore(*scheduler, 0);
+    os::mutex mutex(*scheduler);
+    int acquired = 0;
+    std::vector<int> log;
+    ASSERT_TRUE(mutex.try_lock());
+    executor->spawn(acquire_then_record(semaphore, acquired));
+    executor->spawn(locked_section(mutex, 0, log, 1));
+    executor->poll();
+    ASSERT_EQ(0, acquired);
+    ASSERT_TRUE(log.empty());
+
+    // Waking the coroutine and its executor thread happens inside the caller's critical section, so interrupts are
+    // only re-enabled once, when that section ends
+    auto enables = os::port::interrupt_enable_count;
+    semaphore.release();
+    ASSERT_EQ(enables + 1, os::port::interrupt_enable_count);
+    enables = os::port::interrupt_enable_count;
+    mutex.unlock();
+    ASSERT_EQ(enables + 1, os::port::interrupt_enable_count);
+
+    executor->poll();
+    ASSERT_EQ(1, acquired);
+    ASSERT_EQ(std::vector<int>({1, -1}), log);
+}
+
+TEST_F(CoroutineTests, test_hundreds_of_coroutines_share_one_thread) {
+    constexpr std::size_t coroutine_count = 200;
+    std::vector<unsigned> toggles(coroutine_count, 0);
+    for ( std::size_t i = 0; i < coroutine_count; i++ ) {
+        ASSERT_TRUE(executor->spawn(blink(1 + (i % 4), 3, toggles[i])));
+    }
+    ASSERT_EQ(coroutine_count, os::coroutine_frames.in_use());
+    executor->poll();
+    for ( uint32_t i = 0; i < 6; i++ ) {
+        tick(1);
+        executor->poll();
+    }
+    for ( std::size_t i = 0; i < coroutine_count; i++ ) {
+        ASSERT_EQ(std::min<std::size_t>(3, 6 / (1 + (i % 4))), toggles[i]);
+    }
+
+    // The remaining coroutines finish and give their frames back
+    for ( uint32_t i = 0; i < 6; i++ ) {
+        tick(1);
+        executor->poll();
+    }
+    ASSERT_EQ(0, os::coroutine_frames.in_use());
+}
+
+TEST_F(CoroutineTests, test_exhausted_frame_pool_fails_to_spawn) {
+    std::vector<unsigned> toggles(OS_COROUTINE_FRAME_COUNT + 1, 0);
+    for ( std::size_t i = 0; i < OS_COROUTINE_FRAME_COUNT; i++ ) {
+        ASSERT_TRUE(executor->spawn(blink(1, 1, toggles[i])));
+    }
+    auto overflow = blink(1, 1, toggles.back());
+    ASSERT_FALSE(overflow.valid());
+    ASSERT_FALSE(executor->spawn(std::move(overflow)));
+
+    executor->poll();
+    tick(1);
+    executor->poll();
+    ASSERT_EQ(0, os::coroutine_frames.in_use());
+}
+
+TEST_F(CoroutineTests, test_awaiting_task_without_frame_gives_no_result) {
+    // Leave exactly one frame for the awaiting coroutine, so the tasks it awaits cannot get one
+    std::vector<unsigned> toggles(OS_COROUTINE_FRAME_COUNT - 1, 0);
+    for ( auto& toggle : toggles ) {
+        ASSERT_TRUE(executor->spawn(blink(1, 1, toggle)));
+    }
+    std::optional<int> sum = 42;
+    bool flag_task_ran = true;
+    bool flag = false;
+    bool finished = false;
+    ASSERT_TRUE(executor->spawn(await_without_frames(sum, flag_task_ran, flag, finished)));
+    ASSERT_EQ(OS_COROUTINE_FRAME_COUNT, os::coroutine_frames.in_use());
+
+    executor->poll();
+    ASSERT_TRUE(finished);
+    ASSERT_FALSE(sum.has_value());
+    ASSERT_FALSE(flag_task_ran);
+    ASSERT_FALSE(flag);
+
+    tick(1);
+    executor->poll();
+    ASSERT_EQ(0, os::coroutine_frames.in_use());
+}
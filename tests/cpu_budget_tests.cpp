@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "cpu_budget.hpp"
+#include "mutex.hpp"
+#include <memory>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 3;
+constexpr uint32_t telemetry_priority = 1;
+constexpr uint32_t control_priority = 3;
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for CPU budget groups. A bursty telemetry thread outranks a control thread, and the telemetry
+*        thread is charged to a budget of 3 ticks every 10 ticks. The telemetry thread starts out active.
+*/
+class CpuBudgetTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        scheduler->policy().set_time_slice(0);
+        internal_thread = make_internal_thread(internal_stack);
+        telemetry = make_thread(1, telemetry_stack, telemetry_priority);
+        control = make_thread(2, control_stack, control_priority);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(telemetry.get());
+        scheduler->register_thread(control.get());
+        telemetry_tcb = scheduler->get_task_by_id(1).value();
+        control_tcb = scheduler->get_task_by_id(2).value();
+        scheduler->select_initial_task();
+        ASSERT_TRUE(scheduler->assign_budget(telemetry.get(), &budget));
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t telemetry_stack[thread_stack_size] = {0};
+    uint32_t control_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> telemetry;
+    std::unique_ptr<os::thread> control;
+    os::task_control_block* telemetry_tcb;
+    os::task_control_block* control_tcb;
+    os::cpu_budget budget{3, 10};
+
+    os::task_control_block* active() {
+        return scheduler->get_active_tcb_ptr();
+    }
+
+    void tick(uint32_t ticks) {
+        for ( uint32_t i = 0; i < ticks; i++ ) {
+            pending_irq = false;
+            scheduler->update_system_ticks(1);
+            scheduler->run();
+        }
+    }
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(CpuBudgetTests, test_group_runs_at_base_priority_within_budget) {
+    tick(2);
+    ASSERT_EQ(telemetry_tcb, active());
+    ASSERT_EQ(telemetry_priority, telemetry_tcb->priority);
+    ASSERT_EQ(1, budget.remaining);
+    ASSERT_FALSE(budget.exhausted);
+}
+
+TEST_F(CpuBudgetTests, test_exhausted_group_is_demoted) {
+    tick(3);
+    ASSERT_TRUE(budget.exhausted);
+    ASSERT_EQ(1, budget.overruns);
+    ASSERT_EQ(os::thread::lowest_priority, telemetry_tcb->priority);
+    ASSERT_EQ(telemetry_priority, telemetry_tcb->base_priority);
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(control_tcb, active());
+}
+
+TEST_F(CpuBudgetTests, test_demoted_group_runs_when_nothing_else_is_ready) {
+    tick(3);
+    scheduler->suspend_thread();
+    ASSERT_EQ(telemetry_tcb, active());
+
+    // Running while throttled is not charged against the next period
+    tick(5);
+    ASSERT_EQ(0, budget.remaining);
+    ASSERT_EQ(1, budget.overruns);
+}
+
+TEST_F(CpuBudgetTests, test_budget_replenishes_at_end_of_period) {
+    // The period starts on the first charged tick, so the budget is refilled on tick 11
+    tick(9);
+    ASSERT_EQ(control_tcb, active());
+    tick(1);
+    ASSERT_EQ(control_tcb, active());
+    tick(1);
+    ASSERT_FALSE(budget.exhausted);
+    ASSERT_EQ(telemetry_priority, telemetry_tcb->priority);
+    ASSERT_EQ(telemetry_tcb, active());
+
+    // The new period gets the full budget
+    tick(2);
+    ASSERT_EQ(telemetry_tcb, active());
+    ASSERT_EQ(1, budget.remaining);
+}
+
+TEST_F(CpuBudgetTests, test_idle_group_is_not_charged) {
+    scheduler->suspend_thread();
+    ASSERT_EQ(control_tcb, active());
+    tick(20);
+    ASSERT_EQ(3, budget.remaining);
+    ASSERT_FALSE(budget.period_running);
+
+    // The next burst starts a fresh period
+    scheduler->resume_thread(telemetry_tcb);
+    ASSERT_EQ(telemetry_tcb, active());
+    tick(1);
+    ASSERT_TRUE(budget.period_running);
+    ASSERT_EQ(31, budget.replenish_tick);
+}
+
+TEST_F(CpuBudgetTests, test_throttled_lock_owner_inherits_waiter_priority) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    tick(3);
+    ASSERT_EQ(control_tcb, active());
+
+    // The control thread blocks on the lock and boosts the throttled owner so that it can release it
+    mutex.lock();
+    ASSERT_EQ(control_priority, telemetry_tcb->priority);
+    ASSERT_EQ(telemetry_tcb, active());
+    mutex.unlock();
+    ASSERT_EQ(os::thread::lowest_priority, telemetry_tcb->priority);
+    ASSERT_EQ(control_tcb, active());
+    ASSERT_EQ(control_tcb, mutex.owner());
+}
+
+TEST_F(CpuBudgetTests, test_custom_throttled_priority) {
+    os::cpu_budget shared_budget{1, 10, 2};
+    ASSERT_TRUE(scheduler->assign_budget(telemetry.get(), &shared_budget));
+    tick(1);
+    ASSERT_EQ(2, telemetry_tcb->priority);
+    ASSERT_EQ(telemetry_tcb, active());
+}
+
+TEST_F(CpuBudgetTests, test_assign_budget_to_unregistered_thread_fails) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto unregistered = make_thread(3, stack, 2);
+    ASSERT_FALSE(scheduler->assign_budget(unregistered.get(), &budget));
+}
@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "edf_policy.hpp"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 3;
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for the earliest deadline first policy. All three threads share the same priority so that only
+*        deadlines decide the order. Thread one starts out active.
+*/
+class EdfPolicyTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count, os::edf_policy>>(set_pending_irq, is_pending_irq);
+        internal_thread = make_internal_thread(internal_stack);
+        thread_one = make_thread(1, stack_one);
+        thread_two = make_thread(2, stack_two);
+        thread_three = make_thread(3, stack_three);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(thread_one.get());
+        scheduler->register_thread(thread_two.get());
+        scheduler->register_thread(thread_three.get());
+        tcb_one = scheduler->get_task_by_id(1).value();
+        tcb_two = scheduler->get_task_by_id(2).value();
+        tcb_three = scheduler->get_task_by_id(3).value();
+        scheduler->select_initial_task();
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t stack_one[thread_stack_size] = {0};
+    uint32_t stack_two[thread_stack_size] = {0};
+    uint32_t stack_three[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count, os::edf_policy>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> thread_one;
+    std::unique_ptr<os::thread> thread_two;
+    std::unique_ptr<os::thread> thread_three;
+    os::task_control_block* tcb_one;
+    os::task_control_block* tcb_two;
+    os::task_control_block* tcb_three;
+
+    os::task_control_block* active() {
+        return scheduler->get_active_tcb_ptr();
+    }
+
+    void tick(uint32_t ticks) {
+        pending_irq = false;
+        scheduler->update_system_ticks(ticks);
+        scheduler->run();
+    }
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(EdfPolicyTests, test_threads_with_deadlines_run_before_background_threads) {
+    ASSERT_EQ(tcb_one, active());
+    scheduler->suspend_thread();
+    ASSERT_EQ(tcb_two, active());
+    scheduler->set_thread_period(10, 10);
+
+    // Thread one has no deadline so it only runs once no thread with a deadline is ready
+    scheduler->resume_thread(tcb_one);
+    ASSERT_EQ(tcb_two, active());
+    scheduler->suspend_thread();
+    ASSERT_EQ(tcb_one, active());
+}
+
+TEST_F(EdfPolicyTests, test_earliest_deadline_runs_first) {
+    scheduler->set_thread_period(20, 20);
+    scheduler->suspend_thread();
+    ASSERT_EQ(tcb_two, active());
+    scheduler->set_thread_period(10, 8);
+
+    // Thread one has a later deadline so it does not preempt thread two
+    scheduler->resume_thread(tcb_one);
+    ASSERT_EQ(tcb_two, active());
+
+    // Thread two finishes its job and sleeps until its next release at tick 10
+    scheduler->complete_thread_job();
+    ASSERT_EQ(tcb_one, active());
+    ASSERT_EQ(os::thread::status::sleeping, thread_two->get_status());
+
+    // The next job of thread two is due at tick 18, which is before thread one's deadline of 20
+    tick(9);
+    ASSERT_EQ(tcb_one, active());
+    tick(1);
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(tcb_two, active());
+    ASSERT_EQ(18, tcb_two->absolute_deadline);
+}
+
+TEST_F(EdfPolicyTests, test_deadline_miss_counted_once_in_tick_path) {
+    scheduler->set_thread_period(10, 5);
+    tick(5);
+    ASSERT_EQ(0, tcb_one->deadline_misses);
+    tick(1);
+    ASSERT_EQ(1, tcb_one->deadline_misses);
+    tick(2);
+    ASSERT_EQ(1, tcb_one->deadline_misses);
+
+    // Finishing late does not count the same job twice
+    scheduler->complete_thread_job();
+    ASSERT_EQ(1, tcb_one->deadline_misses);
+    ASSERT_EQ(os::thread::status::sleeping, thread_one->get_status());
+
+    // The next job meets its deadline
+    tick(2);
+    ASSERT_EQ(tcb_one, active());
+    tick(1);
+    scheduler->complete_thread_job();
+    ASSERT_EQ(1, tcb_one->deadline_misses);
+}
+
+TEST_F(EdfPolicyTests, test_late_completion_counts_deadline_miss) {
+    scheduler->set_thread_period(10, 5);
+    scheduler->update_system_ticks(7);
+    scheduler->complete_thread_job();
+    ASSERT_EQ(1, tcb_one->deadline_misses);
+}
+
+TEST_F(EdfPolicyTests, test_overrun_releases_next_job_immediately) {
+    scheduler->set_thread_period(5, 5);
+    scheduler->update_system_ticks(7);
+    scheduler->complete_thread_job();
+    ASSERT_EQ(tcb_one, active());
+    ASSERT_NE(os::thread::status::sleeping, thread_one->get_status());
+    ASSERT_EQ(5, tcb_one->release_tick);
+    ASSERT_EQ(10, tcb_one->absolute_deadline);
+}
+
+TEST_F(EdfPolicyTests, test_complete_job_without_period_does_nothing) {
+    scheduler->complete_thread_job();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(tcb_one, active());
+    ASSERT_NE(os::thread::status::sleeping, thread_one->get_status());
+}
+
+TEST(EdfPolicyHeapTests, test_heap_orders_by_deadline_after_random_removals) {
+    std::array<os::task_control_block, MAX_THREAD_COUNT> tcbs = {};
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> deadlines(1, 1000);
+    os::edf_policy policy;
+    for ( auto& tcb : tcbs ) {
+        tcb.relative_deadline = 1;
+        tcb.absolute_deadline = deadlines(rng);
+        policy.on_ready(&tcb);
+    }
+
+    // Remove every third thread from the middle of the heap
+    std::vector<os::task_control_block*> remaining;
+    for ( std::size_t i = 0; i < tcbs.size(); i++ ) {
+        if ( i % 3 == 1 ) {
+            policy.on_block(&tcbs[i]);
+        } else {
+            remaining.push_back(&tcbs[i]);
+        }
+    }
+    std::sort(remaining.begin(), remaining.end(), os::edf_policy::runs_before);
+
+    for ( auto* expected : remaining ) {
+        auto* next = policy.pick_next();
+        ASSERT_EQ(expected, next);
+        policy.on_block(next);
+    }
+    ASSERT_EQ(nullptr, policy.pick_next());
+}
+
+TEST(EdfPolicyHeapTests, test_heap_does_not_overrun_when_full) {
+    std::array<os::task_control_block, os::edf_policy::max_ready_threads + 1> tcbs = {};
+    os::edf_policy policy;
+    for ( std::size_t i = 0; i < tcbs.size(); i++ ) {
+        tcbs[i].relative_deadline = 1;
+        tcbs[i].absolute_deadline = static_cast<uint32_t>(tcbs.size() - i);
+        policy.on_ready(&tcbs[i]);
+    }
+
+    // The thread past the capacity is not added, so the earliest deadline in the heap is the last one that fit
+    ASSERT_EQ(&tcbs[tcbs.size() - 2], policy.pick_next());
+    static_assert(os::policy_holds_threads<os::edf_policy, MAX_THREAD_COUNT>());
+    static_assert(!os::policy_holds_threads<os::edf_policy, MAX_THREAD_COUNT + 1>());
+    static_assert(os::policy_holds_threads<os::fixed_priority_policy, MAX_THREAD_COUNT + 1>());
+}
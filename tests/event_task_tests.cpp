@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "event_task.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/*********************************** Consts ********************************************/
+constexpr std::size_t priority_levels = 4;
+constexpr std::size_t queue_depth = 4;
+
+/************************************ Local Variables ********************************************/
+static std::unique_ptr<os::basic_event_kernel<priority_levels>> kernel;
+static uint32_t pending_interrupts;
+static std::vector<std::string> trace;
+static bool interrupts_masked;
+
+/************************************ Local Functions ********************************************/
+/**
+ * \brief fake interrupt controller that runs the highest priority pending event task interrupt as long as it outranks
+ *        the event task that is already running, the same way the NVIC nests interrupts
+*/
+static void run_pending_interrupts() {
+    while ( !interrupts_masked && (pending_interrupts != 0) ) {
+        auto priority = static_cast<uint32_t>(__builtin_ctz(pending_interrupts));
+        if ( priority >= kernel->get_active_priority() ) {
+            return;
+        }
+        pending_interrupts &= ~(1u << priority);
+        kernel->dispatch(priority);
+    }
+}
+
+/**
+ * \brief fake pending IRQ for an event task priority level
+*/
+static void pend_interrupt(uint32_t priority) {
+    pending_interrupts |= (1u << priority);
+    run_pending_interrupts();
+}
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for run-to-completion event tasks. The tasks record each signal they handle in a trace, and some
+*        signals make a task post to another task from inside its handler.
+*/
+class EventTaskTests : public ::testing::Test {
+protected:
+    //!< Signal that makes a task post to the other task before it returns
+    static constexpr os::event_task::signal forward = 100;
+
+    static void high_handler(os::event_task& task, os::event_task::signal sig) {
+        (void)task;
+        trace.push_back("high " + std::to_string(sig));
+        if ( sig == forward ) {
+            kernel->post(*low_task, 1);
+            trace.push_back("high done");
+        }
+    }
+
+    static void low_handler(os::event_task& task, os::event_task::signal sig) {
+        (void)task;
+        trace.push_back("low " + std::to_string(sig));
+        if ( sig == forward ) {
+            kernel->post(*high_task, 1);
+            trace.push_back("low done");
+        }
+    }
+
+    void SetUp(void) override {
+        kernel = std::make_unique<os::basic_event_kernel<priority_levels>>(pend_interrupt);
+        high_task = std::make_unique<os::static_event_task<queue_depth>>(high_handler, 1);
+        low_task = std::make_unique<os::static_event_task<queue_depth>>(low_handler, 3);
+        ASSERT_TRUE(kernel->register_task(*high_task));
+        ASSERT_TRUE(kernel->register_task(*low_task));
+        pending_interrupts = 0;
+        interrupts_masked = false;
+        trace.clear();
+    }
+
+public:
+    static inline std::unique_ptr<os::static_event_task<queue_depth>> high_task;
+    static inline std::unique_ptr<os::static_event_task<queue_depth>> low_task;
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(EventTaskTests, test_post_from_thread_runs_task_to_completion) {
+    ASSERT_TRUE(kernel->post(*low_task, 7));
+    ASSERT_EQ(std::vector<std::string>({"low 7"}), trace);
+    ASSERT_EQ(0, low_task->get_queued_count());
+    ASSERT_EQ(kernel->idle_priority, kernel->get_active_priority());
+}
+
+TEST_F(EventTaskTests, test_higher_priority_task_preempts_running_task) {
+    kernel->post(*low_task, forward);
+    ASSERT_EQ(std::vector<std::string>({"low 100", "high 1", "low done"}), trace);
+}
+
+TEST_F(EventTaskTests, test_lower_priority_task_runs_after_running_task) {
+    kernel->post(*high_task, forward);
+    ASSERT_EQ(std::vector<std::string>({"high 100", "high done", "low 1"}), trace);
+}
+
+TEST_F(EventTaskTests, test_signals_are_handled_in_order) {
+    interrupts_masked = true;
+    kernel->post(*low_task, 1);
+    kernel->post(*low_task, 2);
+    kernel->post(*low_task, 3);
+    ASSERT_TRUE(trace.empty());
+    ASSERT_EQ(3, low_task->get_queued_count());
+
+    // All queued signals are handled by a single interrupt
+    interrupts_masked = false;
+    run_pending_interrupts();
+    ASSERT_EQ(std::vector<std::string>({"low 1", "low 2", "low 3"}), trace);
+}
+
+TEST_F(EventTaskTests, test_post_to_full_queue_fails) {
+    interrupts_masked = true;
+    for ( std::size_t i = 0; i < queue_depth; i++ ) {
+        ASSERT_TRUE(kernel->post(*low_task, static_cast<os::event_task::signal>(i)));
+    }
+    ASSERT_FALSE(kernel->post(*low_task, 99));
+    ASSERT_EQ(queue_depth, low_task->get_queued_count());
+}
+
+TEST_F(EventTaskTests, test_highest_priority_pending_task_runs_first) {
+    interrupts_masked = true;
+    kernel->post(*low_task, 1);
+    kernel->post(*high_task, 2);
+    interrupts_masked = false;
+    run_pending_interrupts();
+    ASSERT_EQ(std::vector<std::string>({"high 2", "low 1"}), trace);
+}
+
+TEST_F(EventTaskTests, test_register_rejects_taken_or_invalid_priority) {
+    os::static_event_task<queue_depth> duplicate(low_handler, 3);
+    os::static_event_task<queue_depth> invalid(low_handler, priority_levels);
+    ASSERT_FALSE(kernel->register_task(duplicate));
+    ASSERT_FALSE(kernel->register_task(invalid));
+}
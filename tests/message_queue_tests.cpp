@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "message_queue.hpp"
+#include <memory>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 2;
+constexpr std::size_t queue_capacity = 2;
+
+/************************************ Local Functions ********************************************/
+/**
+ * \brief Large message type that counts how often it is constructed, copied and moved
+ */
+struct large_message {
+    static inline int constructed = 0;
+    static inline int copied = 0;
+    static inline int moved = 0;
+
+    large_message() {
+        constructed++;
+    }
+    large_message(uint32_t id, uint8_t fill)
+        : id(id) {
+        payload.fill(fill);
+        constructed++;
+    }
+    large_message(const large_message& other)
+        : id(other.id)
+        , payload(other.payload) {
+        copied++;
+    }
+    large_message& operator=(large_message&& other) {
+        id = other.id;
+        payload = other.payload;
+        moved++;
+        return *this;
+    }
+
+    uint32_t id{0};
+    std::array<uint8_t, 64> payload{};
+};
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for message queues. The receiver (priority 1) starts out active and the sender (priority 2) runs
+*        whenever the receiver is blocked.
+*/
+class MessageQueueTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        scheduler->policy().set_time_slice(0);
+        internal_thread = make_internal_thread(internal_stack);
+        receiver = make_thread(0, receiver_stack, 1);
+        sender = make_thread(1, sender_stack, 2);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(receiver.get());
+        scheduler->register_thread(sender.get());
+        receiver_tcb = scheduler->get_task_by_id(0).value();
+        sender_tcb = scheduler->get_task_by_id(1).value();
+        scheduler->select_initial_task();
+        queue = std::make_unique<os::message_queue<int, queue_capacity>>(*scheduler);
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t receiver_stack[thread_stack_size] = {0};
+    uint32_t sender_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> receiver;
+    std::unique_ptr<os::thread> sender;
+    std::unique_ptr<os::message_queue<int, queue_capacity>> queue;
+    os::task_control_block* receiver_tcb;
+    os::task_control_block* sender_tcb;
+
+    void tick() {
+        pending_irq = false;
+        scheduler->update_system_ticks(1);
+        scheduler->run();
+    }
+};
+
+/************************************ Unit Tests ********************************************/
+TEST_F(MessageQueueTests, test_messages_are_received_in_send_order) {
+    ASSERT_TRUE(queue->try_send(1));
+    ASSERT_TRUE(queue->send(2));
+    ASSERT_TRUE(queue->full());
+    ASSERT_FALSE(queue->try_send(3));
+    ASSERT_EQ(1, queue->try_receive().value());
+    ASSERT_EQ(2, queue->receive().value());
+    ASSERT_TRUE(queue->empty());
+    ASSERT_FALSE(queue->try_receive().has_value());
+}
+
+TEST_F(MessageQueueTests, test_receive_blocks_until_a_message_is_sent) {
+    ASSERT_FALSE(queue->receive(10).has_value());
+    ASSERT_EQ(receiver->get_status(), os::thread::status::sleeping);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), sender_tcb);
+
+    // Sending from the lower priority thread wakes the receiver, which preempts it
+    pending_irq = false;
+    ASSERT_TRUE(queue->try_send(42));
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    ASSERT_EQ(receiver_tcb->wait_status, os::wait_result::signaled);
+    ASSERT_EQ(42, queue->try_receive().value());
+}
+
+TEST_F(MessageQueueTests, test_receive_times_out_without_a_message) {
+    ASSERT_FALSE(queue->receive(3).has_value());
+    tick();
+    tick();
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), sender_tcb);
+    tick();
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    ASSERT_EQ(receiver_tcb->wait_status, os::wait_result::timed_out);
+
+    // The timed out receiver is no longer waiting, so a later send does not switch threads
+    scheduler->sleep_thread(100);
+    pending_irq = false;
+    ASSERT_TRUE(queue->try_send(1));
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(receiver->get_status(), os::thread::status::sleeping);
+}
+
+TEST_F(MessageQueueTests, test_zero_timeout_does_not_block) {
+    ASSERT_FALSE(queue->receive(0).has_value());
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    ASSERT_TRUE(queue->send(1, 0));
+    ASSERT_TRUE(queue->send(2, 0));
+    ASSERT_FALSE(queue->send(3, 0));
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+}
+
+TEST_F(MessageQueueTests, test_send_blocks_while_full_until_a_message_is_received) {
+    ASSERT_TRUE(queue->try_send(1));
+    ASSERT_TRUE(queue->try_send(2));
+    ASSERT_FALSE(queue->send(3));
+    ASSERT_EQ(receiver->get_status(), os::thread::status::suspended);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), sender_tcb);
+
+    ASSERT_EQ(1, queue->try_receive().value());
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    ASSERT_EQ(receiver_tcb->wait_status, os::wait_result::signaled);
+    ASSERT_TRUE(queue->try_send(3));
+}
+
+TEST_F(MessageQueueTests, test_emplace_and_receive_into_do_not_copy) {
+    os::message_queue<large_message, queue_capacity> messages(*scheduler);
+    large_message::constructed = 0;
+    large_message::copied = 0;
+    large_message::moved = 0;
+
+    messages.emplace(7u, static_cast<uint8_t>(0xAB));
+    ASSERT_TRUE(messages.try_emplace(8u, static_cast<uint8_t>(0xCD)));
+    ASSERT_FALSE(messages.try_emplace(9u, static_cast<uint8_t>(0xEF)));
+    ASSERT_EQ(2, large_message::constructed);
+
+    large_message destination;
+    ASSERT_TRUE(messages.receive_into(destination));
+    ASSERT_EQ(7u, destination.id);
+    ASSERT_EQ(0xAB, destination.payload[63]);
+    ASSERT_TRUE(messages.try_receive_into(destination));
+    ASSERT_EQ(8u, destination.id);
+    ASSERT_FALSE(messages.try_receive_into(destination));
+    ASSERT_EQ(0, large_message::copied);
+    ASSERT_EQ(2, large_message::moved);
+}
+
+TEST_F(MessageQueueTests, test_move_only_messages) {
+    os::message_queue<std::unique_ptr<int>, queue_capacity> pointers(*scheduler);
+    ASSERT_TRUE(pointers.send(std::make_unique<int>(5)));
+    ASSERT_TRUE(pointers.try_send(std::make_unique<int>(6)));
+    ASSERT_EQ(5, *pointers.receive().value());
+    std::unique_ptr<int> destination;
+    ASSERT_TRUE(pointers.receive_into(destination));
+    ASSERT_EQ(6, *destination);
+}
+
+TEST_F(MessageQueueTests, test_try_calls_keep_the_callers_interrupt_state) {
+    // An interrupt handler running with interrupts masked sends and receives without unmasking them
+    DISABLE_INTERRUPTS();
+    auto enables = os::port::interrupt_enable_count;
+    ASSERT_TRUE(queue->try_send(1));
+    ASSERT_TRUE(queue->try_emplace(2));
+    ASSERT_EQ(1, queue->try_receive().value());
+    int destination = 0;
+    ASSERT_TRUE(queue->try_receive_into(destination));
+    ASSERT_EQ(2, destination);
+    EXPECT_TRUE(os::port::interrupts_masked);
+    EXPECT_EQ(enables, os::port::interrupt_enable_count);
+    ENABLE_INTERRUPTS();
+
+    // Called with interrupts enabled, they are enabled again afterwards
+    ASSERT_TRUE(queue->try_send(3));
+    EXPECT_FALSE(os::port::interrupts_masked);
+}
@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "mutex.hpp"
+#include <memory>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 4;
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for the priority inheritance mutex. The mutex calls act on behalf of whichever thread the
+*        scheduler has made active, so each test drives the threads by suspending and resuming them. Thread priorities
+*        are high = 1, medium = 3, and low = 5. The low priority thread starts out active.
+*/
+class MutexTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        internal_thread = make_internal_thread(internal_stack);
+        low = make_thread(1, low_stack, 5);
+        medium = make_thread(2, medium_stack, 3);
+        high = make_thread(3, high_stack, 1);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(low.get());
+        scheduler->register_thread(medium.get());
+        scheduler->register_thread(high.get());
+        low_tcb = scheduler->get_task_by_id(1).value();
+        medium_tcb = scheduler->get_task_by_id(2).value();
+        high_tcb = scheduler->get_task_by_id(3).value();
+
+        // Park the higher priority threads so that the low priority thread runs first
+        scheduler->select_initial_task();
+        scheduler->suspend_thread();
+        scheduler->suspend_thread();
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t low_stack[thread_stack_size] = {0};
+    uint32_t medium_stack[thread_stack_size] = {0};
+    uint32_t high_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> low;
+    std::unique_ptr<os::thread> medium;
+    std::unique_ptr<os::thread> high;
+    os::task_control_block* low_tcb;
+    os::task_control_block* medium_tcb;
+    os::task_control_block* high_tcb;
+
+    os::task_control_block* active() {
+        return scheduler->get_active_tcb_ptr();
+    }
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(MutexTests, test_initial_thread_is_low_priority) {
+    ASSERT_EQ(low_tcb, active());
+    ASSERT_EQ(os::thread::status::suspended, medium->get_status());
+    ASSERT_EQ(os::thread::status::suspended, high->get_status());
+}
+
+TEST_F(MutexTests, test_uncontended_lock_sets_owner_without_boost) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_EQ(5, low_tcb->priority);
+    mutex.unlock();
+    ASSERT_EQ(nullptr, mutex.owner());
+    ASSERT_FALSE(pending_irq);
+}
+
+TEST_F(MutexTests, test_try_lock_fails_when_owned) {
+    os::mutex mutex(*scheduler);
+    ASSERT_TRUE(mutex.try_lock());
+    scheduler->resume_thread(high_tcb);
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_FALSE(mutex.try_lock());
+    ASSERT_EQ(low_tcb, mutex.owner());
+}
+
+TEST_F(MutexTests, test_owner_inherits_waiting_thread_priority) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    ASSERT_EQ(high_tcb, active());
+
+    // High blocks on the mutex and the low priority owner runs at high priority
+    mutex.lock();
+    ASSERT_EQ(os::thread::status::suspended, high->get_status());
+    ASSERT_EQ(1, low_tcb->priority);
+    ASSERT_EQ(5, low_tcb->base_priority);
+    ASSERT_EQ(low_tcb, active());
+
+    // A medium priority thread becoming ready can no longer preempt the boosted owner
+    scheduler->resume_thread(medium_tcb);
+    ASSERT_EQ(low_tcb, active());
+}
+
+TEST_F(MutexTests, test_unlock_restores_priority_and_hands_off_ownership) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    mutex.lock();
+    pending_irq = false;
+    mutex.unlock();
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_EQ(high_tcb, mutex.owner());
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::signaled, high_tcb->wait_status);
+}
+
+TEST_F(MutexTests, test_inheritance_propagates_through_chain) {
+    os::mutex first(*scheduler);
+    os::mutex second(*scheduler);
+
+    // Low owns the first mutex. Medium owns the second and then waits on the first
+    first.lock();
+    scheduler->resume_thread(medium_tcb);
+    ASSERT_EQ(medium_tcb, active());
+    second.lock();
+    first.lock();
+    ASSERT_EQ(3, low_tcb->priority);
+    ASSERT_EQ(low_tcb, active());
+
+    // High waits on the second mutex, which boosts medium and, through it, low
+    scheduler->resume_thread(high_tcb);
+    ASSERT_EQ(high_tcb, active());
+    second.lock();
+    ASSERT_EQ(1, medium_tcb->priority);
+    ASSERT_EQ(1, low_tcb->priority);
+    ASSERT_EQ(low_tcb, active());
+
+    // Releasing the first mutex unwinds low and lets medium finish at the inherited priority
+    first.unlock();
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_EQ(medium_tcb, active());
+    ASSERT_EQ(medium_tcb, first.owner());
+    ASSERT_EQ(1, medium_tcb->priority);
+
+    second.unlock();
+    ASSERT_EQ(3, medium_tcb->priority);
+    ASSERT_EQ(high_tcb, active());
+}
+
+TEST_F(MutexTests, test_nested_mutexes_unwind_one_level_at_a_time) {
+    os::mutex first(*scheduler);
+    os::mutex second(*scheduler);
+    first.lock();
+    second.lock();
+
+    // Medium waits on the second mutex and high waits on the first
+    scheduler->resume_thread(medium_tcb);
+    second.lock();
+    ASSERT_EQ(3, low_tcb->priority);
+    scheduler->resume_thread(high_tcb);
+    first.lock();
+    ASSERT_EQ(1, low_tcb->priority);
+
+    // Releasing the first mutex drops low to the priority still inherited through the second
+    first.unlock();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(3, low_tcb->priority);
+
+    // Once high is out of the way, low finishes and drops back to its base priority
+    scheduler->suspend_thread();
+    ASSERT_EQ(low_tcb, active());
+    second.unlock();
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_EQ(medium_tcb, active());
+    ASSERT_EQ(medium_tcb, second.owner());
+}
+
+TEST_F(MutexTests, test_waiters_acquire_in_priority_order) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    scheduler->resume_thread(medium_tcb);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    mutex.lock();
+    ASSERT_EQ(low_tcb, active());
+    mutex.unlock();
+    ASSERT_EQ(high_tcb, mutex.owner());
+    ASSERT_EQ(high_tcb, active());
+
+    // The remaining medium priority waiter is now inherited by the new owner, which already outranks it
+    ASSERT_EQ(1, high_tcb->priority);
+    mutex.unlock();
+    ASSERT_EQ(medium_tcb, mutex.owner());
+}
+
+TEST_F(MutexTests, test_timed_out_waiter_stops_boosting_owner) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    // On the host the call returns as soon as high is parked, before the wait has an outcome
+    (void)mutex.try_lock_for(5);
+    ASSERT_EQ(os::thread::status::sleeping, high->get_status());
+    ASSERT_EQ(1, low_tcb->priority);
+
+    scheduler->update_system_ticks(5);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_EQ(os::wait_result::timed_out, high_tcb->wait_status);
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(low_tcb, mutex.owner());
+}
+
+TEST_F(MutexTests, test_try_lock_for_returns_false_once_the_timeout_expires) {
+    os::mutex mutex(*scheduler);
+    ASSERT_TRUE(mutex.try_lock_for(5));
+    scheduler->resume_thread(high_tcb);
+
+    // An expired timeout fails right away without blocking or boosting the owner
+    ASSERT_FALSE(mutex.try_lock_for(0));
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_EQ(5, low_tcb->priority);
+
+    // A timed out wait leaves the mutex with its owner, and high resumes with the result that try_lock_for returns
+    (void)mutex.try_lock_for(5);
+    scheduler->update_system_ticks(5);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::timed_out, active()->wait_status);
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_FALSE(mutex.try_lock());
+}
+
+TEST_F(MutexTests, test_try_lock_for_returns_true_when_handed_the_mutex_inside_the_window) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    (void)mutex.try_lock_for(5);
+    ASSERT_EQ(low_tcb, active());
+
+    mutex.unlock();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(high_tcb, mutex.owner());
+    ASSERT_EQ(os::wait_result::signaled, active()->wait_status);
+
+    // The hand over cancels the timeout, so it does not fire later
+    scheduler->update_system_ticks(5);
+    scheduler->run();
+    ASSERT_EQ(os::wait_result::signaled, high_tcb->wait_status);
+    ASSERT_EQ(high_tcb, mutex.owner());
+}
+
+TEST_F(MutexTests, test_try_lock_until_a_passed_deadline_does_not_block) {
+    os::mutex mutex(*scheduler);
+    scheduler->update_system_ticks(10);
+    ASSERT_TRUE(mutex.try_lock_until(5));
+    scheduler->resume_thread(high_tcb);
+    pending_irq = false;
+
+    ASSERT_FALSE(mutex.try_lock_until(5));
+    ASSERT_FALSE(mutex.try_lock_until(10));
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::thread::status::active, high->get_status());
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_FALSE(pending_irq);
+}
+
+TEST_F(MutexTests, test_try_lock_until_a_future_deadline_waits_until_that_tick) {
+    os::mutex mutex(*scheduler);
+    scheduler->update_system_ticks(10);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    (void)mutex.try_lock_until(15);
+    ASSERT_EQ(os::thread::status::sleeping, high->get_status());
+    ASSERT_EQ(1, low_tcb->priority);
+
+    scheduler->update_system_ticks(4);
+    scheduler->run();
+    ASSERT_EQ(os::thread::status::sleeping, high->get_status());
+    scheduler->update_system_ticks(1);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::timed_out, high_tcb->wait_status);
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_EQ(5, low_tcb->priority);
+}
+
+TEST_F(MutexTests, test_ceiling_mutex_raises_owner_immediately) {
+    os::ceiling_mutex mutex(*scheduler, 1);
+    mutex.lock();
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_EQ(1, low_tcb->priority);
+
+    // Threads below the ceiling cannot preempt the owner
+    scheduler->resume_thread(medium_tcb);
+    scheduler->resume_thread(high_tcb);
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(low_tcb, active());
+}
+
+TEST_F(MutexTests, test_ceiling_mutex_unlock_restores_priority_and_preempts) {
+    os::ceiling_mutex mutex(*scheduler, 1);
+    mutex.lock();
+    scheduler->resume_thread(medium_tcb);
+    mutex.unlock();
+    ASSERT_EQ(nullptr, mutex.owner());
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(medium_tcb, active());
+}
+
+TEST_F(MutexTests, test_nested_ceiling_mutexes_unwind_to_outer_ceiling) {
+    os::ceiling_mutex outer(*scheduler, 3);
+    os::ceiling_mutex inner(*scheduler, 1);
+    outer.lock();
+    ASSERT_EQ(3, low_tcb->priority);
+    inner.lock();
+    ASSERT_EQ(1, low_tcb->priority);
+    inner.unlock();
+    ASSERT_EQ(3, low_tcb->priority);
+    outer.unlock();
+    ASSERT_EQ(5, low_tcb->priority);
+}
+
+TEST_F(MutexTests, test_ceiling_does_not_lower_higher_priority_owner) {
+    os::ceiling_mutex mutex(*scheduler, 3);
+    scheduler->resume_thread(high_tcb);
+    mutex.lock();
+    ASSERT_EQ(1, high_tcb->priority);
+    mutex.unlock();
+    ASSERT_EQ(1, high_tcb->priority);
+}
+
+TEST_F(MutexTests, test_unlock_of_unlocked_mutex_does_nothing) {
+    os::mutex mutex(*scheduler);
+    mutex.unlock();
+    ASSERT_EQ(nullptr, mutex.owner());
+    ASSERT_EQ(5, low_tcb->priority);
+    ASSERT_FALSE(pending_irq);
+    ASSERT_TRUE(mutex.try_lock());
+    ASSERT_EQ(low_tcb, mutex.owner());
+}
+
+TEST_F(MutexTests, test_unlock_by_non_owner_is_rejected) {
+    os::mutex mutex(*scheduler);
+    mutex.lock();
+    scheduler->resume_thread(high_tcb);
+    mutex.lock();
+    ASSERT_EQ(1, low_tcb->priority);
+
+    // Medium runs while the boosted owner is suspended and tries to release the mutex it does not own
+    scheduler->resume_thread(medium_tcb);
+    scheduler->suspend_thread();
+    ASSERT_EQ(medium_tcb, active());
+    mutex.unlock();
+    ASSERT_EQ(low_tcb, mutex.owner());
+    ASSERT_EQ(1, low_tcb->priority);
+    ASSERT_EQ(3, medium_tcb->priority);
+    ASSERT_EQ(os::thread::status::suspended, high->get_status());
+    ASSERT_EQ(medium_tcb, active());
+}
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include <memory>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 2;
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for direct-to-thread notifications. The receiver (priority 1) starts out active and the sender
+*        (priority 2) runs whenever the receiver is blocked.
+*/
+class NotificationTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        scheduler->policy().set_time_slice(0);
+        internal_thread = make_internal_thread(internal_stack);
+        receiver = make_thread(0, receiver_stack, 1);
+        sender = make_thread(1, sender_stack, 2);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(receiver.get());
+        scheduler->register_thread(sender.get());
+        receiver_tcb = scheduler->get_task_by_id(0).value();
+        sender_tcb = scheduler->get_task_by_id(1).value();
+        scheduler->select_initial_task();
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t receiver_stack[thread_stack_size] = {0};
+    uint32_t sender_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> receiver;
+    std::unique_ptr<os::thread> sender;
+    os::task_control_block* receiver_tcb;
+    os::task_control_block* sender_tcb;
+
+    void tick() {
+        pending_irq = false;
+        scheduler->update_system_ticks(1);
+        scheduler->run();
+    }
+};
+
+/************************************ Unit Tests ********************************************/
+TEST_F(NotificationTests, test_take_blocks_until_given_and_the_receiver_preempts_the_sender) {
+    scheduler->block_on_notification(0);
+    EXPECT_EQ(receiver->get_status(), os::thread::status::suspended);
+    EXPECT_EQ(receiver_tcb->notification, os::notification_state::waiting);
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), sender_tcb);
+
+    pending_irq = false;
+    EXPECT_TRUE(scheduler->notify_thread(receiver_tcb, 0, os::notify_action::increment));
+    EXPECT_TRUE(pending_irq);
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    EXPECT_EQ(receiver_tcb->wait_status, os::wait_result::signaled);
+
+    EXPECT_EQ(scheduler->take_notification_count(true), 1u);
+    EXPECT_EQ(receiver_tcb->notification_value, 0u);
+    EXPECT_EQ(receiver_tcb->notification, os::notification_state::none);
+}
+
+TEST_F(NotificationTests, test_take_with_a_pending_notification_does_not_block) {
+    scheduler->notify_thread(receiver_tcb, 0, os::notify_action::increment);
+    pending_irq = false;
+    scheduler->block_on_notification(0);
+    EXPECT_FALSE(pending_irq);
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    EXPECT_EQ(receiver_tcb->wait_status, os::wait_result::signaled);
+    EXPECT_EQ(scheduler->take_notification_count(true), 1u);
+}
+
+TEST_F(NotificationTests, test_take_counts_gives_like_a_counting_semaphore) {
+    for ( int i = 0; i < 3; i++ ) {
+        scheduler->notify_thread(receiver_tcb, 0, os::notify_action::increment);
+    }
+    for ( uint32_t expected = 3; expected > 0; expected-- ) {
+        scheduler->block_on_notification(0);
+        EXPECT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+        EXPECT_EQ(scheduler->take_notification_count(false), expected);
+    }
+    EXPECT_EQ(receiver_tcb->notification, os::notification_state::none);
+
+    scheduler->block_on_notification(0);
+    EXPECT_EQ(receiver->get_status(), os::thread::status::suspended);
+}
+
+TEST_F(NotificationTests, test_set_bits_accumulate_until_the_receiver_waits) {
+    scheduler->notify_thread(receiver_tcb, 0x01, os::notify_action::set_bits);
+    scheduler->notify_thread(receiver_tcb, 0x04, os::notify_action::set_bits);
+    scheduler->block_on_notification(0xFFFFFFFF);
+    auto value = scheduler->take_notification_value(0x01);
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(value.value(), 0x05u);
+    EXPECT_EQ(receiver_tcb->notification_value, 0x04u);
+}
+
+TEST_F(NotificationTests, test_wait_clears_bits_on_entry_only_without_a_pending_notification) {
+    receiver_tcb->notification_value = 0xF0;
+    scheduler->block_on_notification(0x30);
+    EXPECT_EQ(receiver_tcb->notification_value, 0xC0u);
+
+    scheduler->notify_thread(receiver_tcb, 0x01, os::notify_action::set_bits);
+    EXPECT_EQ(scheduler->take_notification_value(0).value(), 0xC1u);
+
+    scheduler->notify_thread(receiver_tcb, 0x02, os::notify_action::set_bits);
+    scheduler->block_on_notification(0xFF);
+    EXPECT_EQ(scheduler->take_notification_value(0xFF).value(), 0xC3u);
+}
+
+TEST_F(NotificationTests, test_overwrite_if_empty_does_not_replace_a_pending_value) {
+    EXPECT_TRUE(scheduler->notify_thread(receiver_tcb, 10, os::notify_action::overwrite_if_empty));
+    EXPECT_FALSE(scheduler->notify_thread(receiver_tcb, 20, os::notify_action::overwrite_if_empty));
+    EXPECT_EQ(receiver_tcb->notification_value, 10u);
+
+    EXPECT_TRUE(scheduler->notify_thread(receiver_tcb, 30, os::notify_action::overwrite));
+    EXPECT_EQ(receiver_tcb->notification_value, 30u);
+
+    EXPECT_EQ(scheduler->take_notification_value(0).value(), 30u);
+    EXPECT_TRUE(scheduler->notify_thread(receiver_tcb, 40, os::notify_action::overwrite_if_empty));
+}
+
+TEST_F(NotificationTests, test_no_action_only_marks_the_notification_pending) {
+    receiver_tcb->notification_value = 7;
+    scheduler->notify_thread(receiver_tcb, 100, os::notify_action::no_action);
+    EXPECT_EQ(receiver_tcb->notification, os::notification_state::pending);
+    EXPECT_EQ(scheduler->take_notification_value(0).value(), 7u);
+}
+
+TEST_F(NotificationTests, test_wait_times_out_without_a_notification) {
+    scheduler->block_on_notification(0, 3);
+    EXPECT_EQ(receiver->get_status(), os::thread::status::sleeping);
+    tick();
+    tick();
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), sender_tcb);
+    tick();
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    EXPECT_EQ(receiver_tcb->wait_status, os::wait_result::timed_out);
+    EXPECT_EQ(receiver_tcb->notification, os::notification_state::none);
+    EXPECT_FALSE(scheduler->take_notification_value(0).has_value());
+}
+
+TEST_F(NotificationTests, test_notify_before_the_timeout_takes_the_receiver_off_the_sleep_list) {
+    scheduler->block_on_notification(0, 10);
+    tick();
+    scheduler->notify_thread(receiver_tcb, 0, os::notify_action::increment);
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    EXPECT_EQ(receiver_tcb->wait_status, os::wait_result::signaled);
+    EXPECT_EQ(scheduler->take_notification_count(true), 1u);
+
+    // The expired timeout must not wake the receiver again
+    scheduler->sleep_thread(20);
+    for ( int i = 0; i < 12; i++ ) {
+        tick();
+    }
+    EXPECT_EQ(receiver->get_status(), os::thread::status::sleeping);
+}
+
+TEST_F(NotificationTests, test_zero_timeout_times_out_without_blocking) {
+    scheduler->block_on_notification(0, 0);
+    EXPECT_EQ(scheduler->get_active_tcb_ptr(), receiver_tcb);
+    EXPECT_EQ(receiver_tcb->wait_status, os::wait_result::timed_out);
+    EXPECT_EQ(scheduler->take_notification_count(true), 0u);
+}
+
+TEST_F(NotificationTests, test_notifying_a_thread_that_is_not_waiting_does_not_switch) {
+    pending_irq = false;
+    scheduler->notify_thread(sender_tcb, 0, os::notify_action::increment);
+    EXPECT_FALSE(pending_irq);
+    EXPECT_EQ(sender->get_status(), os::thread::status::pending);
+    EXPECT_EQ(sender_tcb->notification_value, 1u);
+}
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "cpu_budget.hpp"
+#include <array>
+#include <memory>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 3;
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for preemption thresholds. Three cooperating worker threads have priorities high = 2,
+*        medium = 3, and low = 4. The high priority worker starts out active.
+*/
+class PreemptionThresholdTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        scheduler->policy().set_time_slice(0);
+        internal_thread = make_internal_thread(internal_stack);
+        high = make_thread(0, high_stack, 2);
+        medium = make_thread(1, medium_stack, 3);
+        low = make_thread(2, low_stack, 4);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(high.get());
+        scheduler->register_thread(medium.get());
+        scheduler->register_thread(low.get());
+        high_tcb = scheduler->get_task_by_id(0).value();
+        medium_tcb = scheduler->get_task_by_id(1).value();
+        low_tcb = scheduler->get_task_by_id(2).value();
+        scheduler->select_initial_task();
+        pending_irq = false;
+        context_switches = 0;
+    }
+
+public:
+    /**
+     * \brief A periodic job in the synthetic workload. The thread runs for a number of ticks and then sleeps.
+     */
+    struct job {
+        uint32_t work;
+        uint32_t sleep;
+        uint32_t remaining;
+        unsigned completed;
+    };
+
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t high_stack[thread_stack_size] = {0};
+    uint32_t medium_stack[thread_stack_size] = {0};
+    uint32_t low_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> high;
+    std::unique_ptr<os::thread> medium;
+    std::unique_ptr<os::thread> low;
+    os::task_control_block* high_tcb;
+    os::task_control_block* medium_tcb;
+    os::task_control_block* low_tcb;
+
+    os::task_control_block* active() {
+        return scheduler->get_active_tcb_ptr();
+    }
+
+    void tick() {
+        pending_irq = false;
+        scheduler->update_system_ticks(1);
+        scheduler->run();
+    }
+
+    /**
+     * \brief Run the workers through a synthetic workload. Each tick the active worker does one tick of work, and
+     *        sleeps once its job is done.
+     * 
+     * \param jobs The job of each worker, indexed by thread id
+     * \param ticks Number of ticks to run for
+     */
+    void run_workload(std::array<job, thread_count>& jobs, uint32_t ticks) {
+        for ( uint32_t i = 0; i < ticks; i++ ) {
+            if ( active()->thread_ptr != internal_thread.get() ) {
+                auto& current = jobs[active()->thread_ptr->get_id()];
+                if ( --current.remaining == 0 ) {
+                    current.completed++;
+                    current.remaining = current.work;
+                    scheduler->sleep_thread(current.sleep);
+                }
+            }
+            tick();
+        }
+    }
+
+    /**
+     * \brief Make the active thread the low priority worker
+     */
+    void run_low_priority_worker() {
+        scheduler->suspend_thread();
+        scheduler->suspend_thread();
+        ASSERT_EQ(low_tcb, active());
+        pending_irq = false;
+        context_switches = 0;
+    }
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(PreemptionThresholdTests, test_threads_within_threshold_do_not_preempt) {
+    run_low_priority_worker();
+    ASSERT_TRUE(scheduler->assign_preemption_threshold(low.get(), 2));
+    scheduler->resume_thread(medium_tcb);
+    scheduler->resume_thread(high_tcb);
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(low_tcb, active());
+
+    // Ticks do not preempt it either
+    tick();
+    ASSERT_EQ(low_tcb, active());
+}
+
+TEST_F(PreemptionThresholdTests, test_thread_above_threshold_preempts) {
+    run_low_priority_worker();
+    ASSERT_TRUE(scheduler->assign_preemption_threshold(low.get(), 3));
+    scheduler->resume_thread(medium_tcb);
+    ASSERT_EQ(low_tcb, active());
+    scheduler->resume_thread(high_tcb);
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(high_tcb, active());
+}
+
+TEST_F(PreemptionThresholdTests, test_blocking_thread_hands_over_to_highest_priority) {
+    run_low_priority_worker();
+    ASSERT_TRUE(scheduler->assign_preemption_threshold(low.get(), 2));
+    scheduler->resume_thread(medium_tcb);
+    scheduler->resume_thread(high_tcb);
+    scheduler->sleep_thread(5);
+    ASSERT_EQ(high_tcb, active());
+}
+
+TEST_F(PreemptionThresholdTests, test_relaxing_threshold_lets_waiting_thread_in) {
+    run_low_priority_worker();
+    ASSERT_TRUE(scheduler->assign_preemption_threshold(low.get(), 2));
+    scheduler->resume_thread(high_tcb);
+    ASSERT_EQ(low_tcb, active());
+    ASSERT_TRUE(scheduler->assign_preemption_threshold(low.get(), os::scheduler_impl::no_preemption_threshold));
+    ASSERT_EQ(high_tcb, active());
+}
+
+TEST_F(PreemptionThresholdTests, test_exhausted_budget_drops_threshold) {
+    run_low_priority_worker();
+    os::cpu_budget budget{1, 10};
+    ASSERT_TRUE(scheduler->assign_budget(low.get(), &budget));
+    ASSERT_TRUE(scheduler->assign_preemption_threshold(low.get(), 2));
+    scheduler->resume_thread(high_tcb);
+    ASSERT_EQ(low_tcb, active());
+    tick();
+    ASSERT_EQ(high_tcb, active());
+}
+
+TEST_F(PreemptionThresholdTests, test_invalid_threshold_is_rejected) {
+    ASSERT_FALSE(scheduler->assign_preemption_threshold(high.get(), 3));
+    ASSERT_EQ(os::scheduler_impl::no_preemption_threshold, high_tcb->preemption_threshold);
+
+    uint32_t stack[thread_stack_size] = {0};
+    auto unregistered = make_thread(3, stack, 2);
+    ASSERT_FALSE(scheduler->assign_preemption_threshold(unregistered.get(), 1));
+}
+
+TEST_F(PreemptionThresholdTests, test_shared_threshold_reduces_context_switches) {
+    const std::array<job, thread_count> workload = {{{1, 3, 1, 0}, {2, 5, 2, 0}, {6, 4, 6, 0}}};
+    constexpr uint32_t workload_ticks = 500;
+
+    auto jobs = workload;
+    run_workload(jobs, workload_ticks);
+    auto preemptive_switches = context_switches;
+    auto preemptive_jobs = jobs;
+
+    // Rerun the same workload with the workers sharing a threshold at the highest worker priority
+    SetUp();
+    for ( auto* worker : {high.get(), medium.get(), low.get()} ) {
+        ASSERT_TRUE(scheduler->assign_preemption_threshold(worker, 2));
+    }
+    jobs = workload;
+    run_workload(jobs, workload_ticks);
+
+    EXPECT_LT(context_switches, preemptive_switches);
+    for ( std::size_t i = 0; i < thread_count; i++ ) {
+        EXPECT_GT(preemptive_jobs[i].completed, 0u);
+        EXPECT_GT(jobs[i].completed, 0u);
+    }
+}
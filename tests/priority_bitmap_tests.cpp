@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "priority_bitmap.hpp"
+#include "gtest/gtest.h"
+
+/************************************ Tests ********************************************/
+TEST(PriorityBitmapTests, test_initial_bitmap_is_empty) {
+    os::priority_bitmap<32> bitmap;
+    ASSERT_TRUE(bitmap.empty());
+    ASSERT_EQ(32, bitmap.highest());
+}
+
+TEST(PriorityBitmapTests, test_highest_priority_is_lowest_number) {
+    os::priority_bitmap<32> bitmap;
+    bitmap.set(31);
+    bitmap.set(7);
+    bitmap.set(12);
+    ASSERT_EQ(7, bitmap.highest());
+    bitmap.clear(7);
+    ASSERT_EQ(12, bitmap.highest());
+    bitmap.clear(12);
+    bitmap.clear(31);
+    ASSERT_TRUE(bitmap.empty());
+}
+
+TEST(PriorityBitmapTests, test_two_level_bitmap_finds_highest_priority) {
+    os::priority_bitmap<256> bitmap;
+    bitmap.set(255);
+    bitmap.set(100);
+    bitmap.set(33);
+    ASSERT_EQ(33, bitmap.highest());
+    bitmap.clear(33);
+    ASSERT_EQ(100, bitmap.highest());
+    bitmap.clear(100);
+    ASSERT_EQ(255, bitmap.highest());
+    ASSERT_TRUE(bitmap.test(255));
+    ASSERT_FALSE(bitmap.test(100));
+}
+
+TEST(PriorityBitmapTests, test_two_level_bitmap_clears_group_only_when_word_is_empty) {
+    os::priority_bitmap<64> bitmap;
+    bitmap.set(40);
+    bitmap.set(41);
+    bitmap.clear(40);
+    ASSERT_FALSE(bitmap.empty());
+    ASSERT_EQ(41, bitmap.highest());
+    bitmap.clear(41);
+    ASSERT_TRUE(bitmap.empty());
+    ASSERT_EQ(64, bitmap.highest());
+}
@@ -4,7 +4,10 @@
 /********************************** Includes *******************************************/
 #include "ring_buffer.hpp"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <span>
 #include <vector>
 
 /*********************************** Consts ********************************************/
@@ -181,4 +184,210 @@ TEST_F(RingBufferTests, test_pop_back_after_wrapping_around) {
     buff.push_back(3);  // Has now wrapped
     auto val = buff.pop_back();
     ASSERT_EQ(val.value(), 2);
-}
\ No newline at end of file
+}
+
+TEST_F(RingBufferTests, test_bulk_push_back_pops_in_order) {
+    std::array<int, 3> values = {1, 2, 3};
+    buffer.push_back(std::span<const int>(values));
+    ASSERT_EQ(3, buffer.size());
+    ASSERT_EQ(1, buffer.pop_back().value());
+    ASSERT_EQ(2, buffer.pop_back().value());
+    ASSERT_EQ(3, buffer.pop_back().value());
+}
+
+TEST_F(RingBufferTests, test_bulk_push_back_wraps_and_overwrites_oldest) {
+    std::array<int, 4> first = {1, 2, 3, 4};
+    std::array<int, 3> second = {5, 6, 7};
+    buffer.push_back(std::span<const int>(first));
+    buffer.push_back(std::span<const int>(second));
+    ASSERT_TRUE(buffer.full());
+    std::array<int, 5> expected = {3, 4, 5, 6, 7};
+    for ( auto value : expected ) {
+        ASSERT_EQ(value, buffer.pop_back().value());
+    }
+    ASSERT_TRUE(buffer.empty());
+}
+
+TEST_F(RingBufferTests, test_bulk_push_back_larger_than_capacity_keeps_newest) {
+    std::array<int, 7> values = {1, 2, 3, 4, 5, 6, 7};
+    buffer.push_back(std::span<const int>(values));
+    ASSERT_TRUE(buffer.full());
+    unsigned expected = 3;
+    for ( auto it = buffer.begin(); it != buffer.end(); ++it ) {
+        ASSERT_EQ(*it, expected++);
+    }
+}
+
+TEST_F(RingBufferTests, test_bulk_pop_back_matches_single_pops_after_wrapping) {
+    for ( int value = 1; value <= 8; value++ ) {
+        buffer.push_back(value);
+    }
+    std::array<int, 8> destination = {};
+    ASSERT_EQ(5, buffer.pop_back(std::span<int>(destination)));
+    std::array<int, 5> expected = {4, 5, 6, 7, 8};
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), destination.begin()));
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_EQ(0, buffer.pop_back(std::span<int>(destination)));
+}
+
+TEST_F(RingBufferTests, test_bulk_pop_back_stops_at_destination_size) {
+    std::array<int, 4> values = {1, 2, 3, 4};
+    buffer.push_back(std::span<const int>(values));
+    std::array<int, 3> destination = {};
+    ASSERT_EQ(3, buffer.pop_back(std::span<int>(destination)));
+    ASSERT_EQ(1, buffer.size());
+    ASSERT_EQ(4, buffer.pop_back().value());
+}
+
+TEST_F(RingBufferTests, test_readable_regions_split_at_the_wrap) {
+    for ( int value = 1; value <= 7; value++ ) {
+        buffer.push_back(value);
+    }
+    auto [first, second] = buffer.readable_regions();
+    ASSERT_EQ(3, first.size());
+    ASSERT_EQ(2, second.size());
+    ASSERT_EQ(3, first[0]);
+    ASSERT_EQ(5, first[2]);
+    ASSERT_EQ(6, second[0]);
+    ASSERT_EQ(7, second[1]);
+
+    buffer.commit_read(first.size());
+    ASSERT_EQ(2, buffer.size());
+    ASSERT_EQ(6, buffer.pop_back().value());
+}
+
+TEST_F(RingBufferTests, test_writable_regions_receive_values_in_place) {
+    buffer.push_back(1);
+    buffer.push_back(2);
+    buffer.pop_back();
+    auto [first, second] = buffer.writable_regions();
+    ASSERT_EQ(3, first.size());
+    ASSERT_EQ(1, second.size());
+    first[0] = 3;
+    first[1] = 4;
+    first[2] = 5;
+    second[0] = 6;
+    buffer.commit_write(first.size() + second.size());
+    ASSERT_TRUE(buffer.full());
+    for ( int value = 2; value <= 6; value++ ) {
+        ASSERT_EQ(value, buffer.pop_back().value());
+    }
+}
+
+/**
+ * \brief Item type that counts its live instances and cannot be default constructed or copied
+ */
+struct tracked_item {
+    static inline int live = 0;
+
+    explicit tracked_item(int value)
+        : value(value) {
+        live++;
+    }
+    tracked_item(tracked_item&& other) noexcept
+        : value(other.value) {
+        live++;
+    }
+    tracked_item& operator=(tracked_item&& other) noexcept {
+        value = other.value;
+        return *this;
+    }
+    tracked_item(const tracked_item&) = delete;
+    tracked_item& operator=(const tracked_item&) = delete;
+    ~tracked_item() {
+        live--;
+    }
+
+    int value;
+};
+
+TEST_F(RingBufferTests, test_construction_does_not_construct_items) {
+    tracked_item::live = 0;
+    ring_buffer<tracked_item, 8> items;
+    ASSERT_EQ(0, tracked_item::live);
+}
+
+TEST_F(RingBufferTests, test_emplace_back_and_front_construct_in_place) {
+    tracked_item::live = 0;
+    {
+        ring_buffer<tracked_item, 4> items;
+        ASSERT_EQ(2, items.emplace_back(2).value);
+        ASSERT_EQ(1, items.emplace_front(1).value);
+        items.emplace_back(3);
+        ASSERT_EQ(3, tracked_item::live);
+        ASSERT_EQ(1, items.pop_back()->value);
+        ASSERT_EQ(3, items.pop_front()->value);
+        ASSERT_EQ(1, tracked_item::live);
+    }
+    // The buffer destroys the item left in it
+    ASSERT_EQ(0, tracked_item::live);
+}
+
+TEST_F(RingBufferTests, test_overwriting_and_flush_destroy_items) {
+    tracked_item::live = 0;
+    ring_buffer<tracked_item, 3> items;
+    for ( int i = 0; i < 5; i++ ) {
+        items.emplace_back(i);
+    }
+    ASSERT_EQ(3, tracked_item::live);
+    ASSERT_EQ(2, items.pop_back()->value);
+    items.flush();
+    ASSERT_EQ(0, tracked_item::live);
+    ASSERT_TRUE(items.empty());
+}
+
+TEST_F(RingBufferTests, test_move_only_items) {
+    ring_buffer<std::unique_ptr<int>, 2> pointers;
+    auto pointer = std::make_unique<int>(5);
+    pointers.push_back(std::move(pointer));
+    pointers.emplace_back(std::make_unique<int>(6));
+    ASSERT_EQ(5, *pointers.pop_back().value());
+    ASSERT_EQ(6, *pointers.pop_back().value());
+}
+
+TEST_F(RingBufferTests, test_push_back_const_lvalue) {
+    const int value = 4;
+    buffer.push_back(value);
+    ASSERT_EQ(4, buffer.pop_back().value());
+}
+
+TEST_F(RingBufferTests, test_pop_front_removes_the_newest_item) {
+    buffer.push_back(1);
+    buffer.push_back(2);
+    buffer.push_back(3);
+    ASSERT_EQ(3, buffer.pop_front().value());
+    ASSERT_EQ(2, buffer.pop_front().value());
+    buffer.push_back(4);
+    ASSERT_EQ(1, buffer.pop_back().value());
+    ASSERT_EQ(4, buffer.pop_back().value());
+    ASSERT_TRUE(buffer.empty());
+}
+
+TEST_F(RingBufferTests, test_push_front_to_full_buffer_overwrites_the_newest_item) {
+    std::array<int, 5> values = {2, 3, 4, 5, 6};
+    for ( auto val : values ) {
+        buffer.push_back(val);
+    }
+    buffer.push_front(1);
+    ASSERT_TRUE(buffer.full());
+    for ( int expected = 1; expected <= 5; expected++ ) {
+        ASSERT_EQ(expected, buffer.pop_back().value());
+    }
+}
+
+TEST_F(RingBufferTests, test_power_of_two_capacity_wraps_both_ways) {
+    ring_buffer<int, 4> buff;
+    for ( int i = 0; i < 10; i++ ) {
+        buff.push_back(i);
+    }
+    buff.push_front(5);
+    std::array<int, 4> expected = {5, 6, 7, 8};
+    for ( auto value : expected ) {
+        ASSERT_EQ(value, buff.pop_back().value());
+    }
+    ASSERT_TRUE(buff.empty());
+    buff.push_front(1);
+    buff.push_front(0);
+    ASSERT_EQ(0, buff.pop_back().value());
+    ASSERT_EQ(1, buff.pop_front().value());
+}
@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "ring_buffer.hpp"
+#include "scheduler_impl.hpp"
+#include "spsc_ring_buffer.hpp"
+#include "thread.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*********************************** Consts ********************************************/
+constexpr uint32_t thread_stack_size = 64;
+constexpr uint32_t benchmark_ticks = 200000;
+constexpr uint32_t sleep_ticks = 0x10000000;
+constexpr uint32_t buffer_items = 2000000;
+constexpr std::size_t buffer_capacity = 256;
+
+/************************************ Local Variables ********************************************/
+static bool pending_irq;
+static volatile uint32_t buffer_sink;
+
+namespace os
+{
+// Threads register themselves with the scheduler singleton on construction, which is not needed here
+class scheduler {
+  public:
+    static void register_new_thread(thread* thread);
+};
+
+void scheduler::register_new_thread(thread* thread) {
+    (void)thread;
+}
+};  // namespace os
+
+/************************************ Local Functions ********************************************/
+static void set_pending_irq() {
+    pending_irq = true;
+}
+
+static bool is_pending_irq() {
+    return pending_irq;
+}
+
+static void thread_task() { }
+
+/**
+ * \brief Reference copy of the original tick handler, which decremented the remaining sleep ticks of every
+ *        thread on every tick. Kept here so that the sorted sleep list can be compared against it.
+ */
+struct legacy_sleeping_thread {
+    os::thread::status status;
+    int32_t suspended_ticks_remaining;
+};
+
+static void legacy_tick(std::vector<legacy_sleeping_thread>& threads, uint32_t ticks) {
+    for ( auto& thread : threads ) {
+        if ( thread.status == os::thread::status::sleeping ) {
+            thread.suspended_ticks_remaining -= ticks;
+            if ( thread.suspended_ticks_remaining <= 0 ) {
+                thread.status = os::thread::status::pending;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Measure the average cost of a tick with every thread sleeping using the original per-thread decrement
+ *
+ * \param thread_count Number of sleeping threads
+ * \retval double Average nanoseconds per tick
+ */
+static double benchmark_legacy_tick(unsigned thread_count) {
+    std::vector<legacy_sleeping_thread> threads(thread_count);
+    for ( unsigned i = 0; i < thread_count; i++ ) {
+        threads[i] = {os::thread::status::sleeping, static_cast<int32_t>(sleep_ticks + i)};
+    }
+    auto start = std::chrono::steady_clock::now();
+    for ( uint32_t tick = 0; tick < benchmark_ticks; tick++ ) {
+        legacy_tick(threads, 1);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / benchmark_ticks;
+}
+
+/**
+ * \brief Measure the average cost of a tick with every thread sleeping using the scheduler's sorted sleep list
+ *
+ * \param thread_count Number of sleeping threads
+ * \retval double Average nanoseconds per tick
+ */
+static double benchmark_sleep_list_tick(unsigned thread_count) {
+    std::vector<uint32_t> stacks(static_cast<std::size_t>(thread_count + 1) * thread_stack_size);
+    std::vector<std::unique_ptr<os::thread>> threads;
+    auto internal_thread = std::make_unique<os::thread>(thread_task, 0xFFFF, stacks.data(), thread_stack_size);
+    auto scheduler = std::make_unique<os::static_scheduler<MAX_THREAD_COUNT>>(set_pending_irq, is_pending_irq);
+    scheduler->set_internal_task(internal_thread.get());
+    for ( unsigned i = 0; i < thread_count; i++ ) {
+        threads.push_back(std::make_unique<os::thread>(thread_task, i + 1, &stacks[(i + 1) * thread_stack_size], thread_stack_size));
+        scheduler->register_thread(threads.back().get());
+    }
+
+    // Put every thread to sleep. Each sleep switches to the next ready thread
+    scheduler->select_initial_task();
+    for ( unsigned i = 0; i < thread_count; i++ ) {
+        scheduler->sleep_thread(sleep_ticks + i);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for ( uint32_t tick = 0; tick < benchmark_ticks; tick++ ) {
+        scheduler->update_system_ticks(1);
+        scheduler->run();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / benchmark_ticks;
+}
+
+/**
+ * \brief Measure the average cost of moving an item through the original ring buffer from one context
+ *
+ * \retval double Average nanoseconds per item
+ */
+static double benchmark_ring_buffer_single() {
+    static ring_buffer<uint32_t, buffer_capacity> buffer;
+    uint32_t sum{0};
+    auto start = std::chrono::steady_clock::now();
+    for ( uint32_t i = 0; i < buffer_items; i += buffer_capacity ) {
+        for ( uint32_t j = 0; j < buffer_capacity; j++ ) {
+            buffer.push_back(i + j);
+        }
+        while ( auto value = buffer.pop_back() ) {
+            sum += value.value();
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    buffer_sink = sum;
+    return elapsed.count() / buffer_items;
+}
+
+/**
+ * \brief Measure the average cost of moving an item through the lock-free ring buffer from one context
+ *
+ * \retval double Average nanoseconds per item
+ */
+static double benchmark_spsc_ring_buffer_single() {
+    static spsc_ring_buffer<uint32_t, buffer_capacity> buffer;
+    uint32_t sum{0};
+    auto start = std::chrono::steady_clock::now();
+    for ( uint32_t i = 0; i < buffer_items; i += buffer_capacity ) {
+        for ( uint32_t j = 0; j < buffer_capacity; j++ ) {
+            buffer.push(i + j);
+        }
+        while ( auto value = buffer.pop() ) {
+            sum += value.value();
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    buffer_sink = sum;
+    return elapsed.count() / buffer_items;
+}
+
+/**
+ * \brief Measure the average cost of moving an item from a producer thread to a consumer thread through the original
+ *        ring buffer, which has to be locked as both sides update its size
+ *
+ * \retval double Average nanoseconds per item
+ */
+static double benchmark_ring_buffer_threads() {
+    static ring_buffer<uint32_t, buffer_capacity> buffer;
+    static std::mutex lock;
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([]() {
+        for ( uint32_t i = 0; i < buffer_items; i++ ) {
+            while ( true ) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if ( !buffer.full() ) {
+                        buffer.push_back(i);
+                        break;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        }
+    });
+    for ( uint32_t received = 0; received < buffer_items; ) {
+        std::optional<uint32_t> value;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            value = buffer.pop_back();
+        }
+        if ( value.has_value() ) {
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / buffer_items;
+}
+
+/**
+ * \brief Measure the average cost of moving an item from a producer thread to a consumer thread through the lock-free
+ *        ring buffer
+ *
+ * \retval double Average nanoseconds per item
+ */
+static double benchmark_spsc_ring_buffer_threads() {
+    static spsc_ring_buffer<uint32_t, buffer_capacity> buffer;
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([]() {
+        for ( uint32_t i = 0; i < buffer_items; i++ ) {
+            while ( !buffer.push(i) ) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for ( uint32_t received = 0; received < buffer_items; ) {
+        if ( buffer.pop().has_value() ) {
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / buffer_items;
+}
+
+int main() {
+    std::printf("Tick handler cost with all threads sleeping (%u ticks)\n", static_cast<unsigned>(benchmark_ticks));
+    std::printf("%8s %20s %20s\n", "threads", "per-thread (ns)", "sleep list (ns)");
+    for ( unsigned thread_count : {8u, 32u, 128u} ) {
+        auto legacy = benchmark_legacy_tick(thread_count);
+        auto sorted = benchmark_sleep_list_tick(thread_count);
+        std::printf("%8u %20.2f %20.2f\n", thread_count, legacy, sorted);
+    }
+
+    std::printf("\nRing buffer throughput (%u items)\n", static_cast<unsigned>(buffer_items));
+    std::printf("%16s %20s %20s\n", "contexts", "ring_buffer (ns)", "spsc (ns)");
+    std::printf("%16s %20.2f %20.2f\n", "one", benchmark_ring_buffer_single(), benchmark_spsc_ring_buffer_single());
+    std::printf("%16s %20.2f %20.2f\n", "two threads", benchmark_ring_buffer_threads(), benchmark_spsc_ring_buffer_threads());
+    return 0;
+}
@@ -6,8 +6,10 @@
 #include "thread.hpp"
 #include "system_clock.hpp"
 #include "scheduler_impl.hpp"
+#include "wait_queue.hpp"
 #include <iostream>
 #include <memory>
+#include <type_traits>
 
 
 /*********************************** Consts ********************************************/
@@ -34,6 +36,18 @@ static bool is_pending_irq(){
     return pending_irq;
 }
 
+/**
+ * \brief fake tickless idle sleep that records the requested idle period and reports a configurable
+ *        number of elapsed ticks, standing in for the hardware timer
+*/
+static uint32_t requested_idle_ticks;
+static uint32_t fake_elapsed_ticks;
+
+static uint32_t fake_suppress_ticks_and_sleep(uint32_t idle_ticks){
+    requested_idle_ticks = idle_ticks;
+    return (fake_elapsed_ticks < idle_ticks) ? fake_elapsed_ticks : idle_ticks;
+}
+
 /************************************ Test Fixtures ********************************************/
 /**
 * \brief test fixture class for testing the scheduler and thread registry components of the OS
@@ -44,7 +58,7 @@ protected:
 
     void SetUp(void) override {
         internal_thread = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 0xFFFF, internal_stack, thread_stack_size);
-        scheduler = std::make_unique<os::scheduler_impl>(thread_count, set_pending_irq, is_pending_irq);
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
         scheduler->set_internal_task(internal_thread.get());
         pending_irq = false;        
     }
@@ -52,8 +66,7 @@ protected:
 public:
     uint32_t internal_stack[thread_stack_size] = {0};
     std::unique_ptr<os::thread> internal_thread;
-    std::unique_ptr<os::scheduler_impl> scheduler;
-    os::system_clock clock;
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
         
     std::unique_ptr<os::thread> create_thread(os::thread::task_pointer task_ptr, uint32_t thread_id, uint32_t *stack_ptr, uint32_t stack_size) {
         return std::make_unique<os::thread>(task_ptr, thread_id, stack_ptr, stack_size);
@@ -63,15 +76,15 @@ public:
 
 /**
  * \brief extentension of the main scheduler test class with some pre-registered threads for some more
- *        complex tests to reduce some boilerplate.
+ *        complex tests to reduce some boilerplate. Thread one has a higher priority than thread two.
 */
 class SchedulerTestsWithPreRegisteredThreads : public SchedulerTests {
 protected:
     void SetUp(void) override {
-        scheduler = std::make_unique<os::scheduler_impl>(thread_count, set_pending_irq, is_pending_irq);
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
         internal_thread = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 0xFFFF, internal_stack, thread_stack_size);
-        thread_one = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack_one, thread_stack_size);
-        thread_two = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack_two, thread_stack_size);   
+        thread_one = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack_one, thread_stack_size, 1);
+        thread_two = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack_two, thread_stack_size, 2);
         scheduler->set_internal_task(internal_thread.get());
         scheduler->register_thread(thread_one.get());
         scheduler->register_thread(thread_two.get());                
@@ -141,6 +154,12 @@ TEST_F(SchedulerTests, test_overfilling_tcb_buffer_fails) {
     ASSERT_FALSE(scheduler->register_thread(thread.get()));
 }
 
+TEST_F(SchedulerTests, test_max_thread_count_is_fixed_at_compile_time) {
+    static_assert(!std::is_copy_constructible_v<os::static_scheduler<thread_count>>);
+    ASSERT_EQ(thread_count, scheduler->get_max_thread_count());
+    ASSERT_GE(sizeof(os::static_scheduler<thread_count>), thread_count * sizeof(os::task_control_block));
+}
+
 TEST_F(SchedulerTests, test_thread_sleep_adds_to_tcb_ticks) {
     uint32_t stack[thread_stack_size] = {0};    
     std::unique_ptr<os::thread> thread = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
@@ -149,7 +168,7 @@ TEST_F(SchedulerTests, test_thread_sleep_adds_to_tcb_ticks) {
     auto maybe_tcb = scheduler->get_task_by_id(1);
     ASSERT_TRUE(maybe_tcb);
     auto tcb = maybe_tcb.value();
-    ASSERT_EQ(100, tcb->suspended_ticks_remaining);
+    ASSERT_EQ(100, tcb->wake_tick);
 }
 
 TEST_F(SchedulerTests, test_sleeping_all_threads_sets_internal_thread_active) {
@@ -161,73 +180,504 @@ TEST_F(SchedulerTests, test_sleeping_all_threads_sets_internal_thread_active) {
     ASSERT_EQ(internal_thread.get(), tcb->thread_ptr);
 }
 
-TEST_F(SchedulerTestsWithPreRegisteredThreads, test_update_from_clock_triggers_context_switch) {    
-    thread_two->set_status(os::thread::status::sleeping);
-    clock.update(1);
+TEST_F(SchedulerTests, test_registering_thread_with_invalid_priority_fails) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto thread = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size, MAX_THREAD_PRIORITIES);
+    ASSERT_FALSE(scheduler->register_thread(thread.get()));
+    ASSERT_EQ(0, scheduler->get_registered_thread_count());
+}
+
+TEST_F(SchedulerTests, test_initial_task_is_highest_priority_thread) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto low = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size, 10);
+    auto high = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size, 3);
+    scheduler->register_thread(low.get());
+    scheduler->register_thread(high.get());
+    scheduler->select_initial_task();
+    ASSERT_EQ(high.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTests, test_priorities_above_32_levels_are_scheduled) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto low = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size, MAX_THREAD_PRIORITIES - 1);
+    auto high = std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size, 40);
+    scheduler->register_thread(low.get());
+    scheduler->register_thread(high.get());
+    scheduler->select_initial_task();
+    ASSERT_EQ(high.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTests, test_equal_priority_threads_run_in_fifo_order) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto first = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
+    auto second = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size);
+    auto third = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 3, stack, thread_stack_size);
+    scheduler->register_thread(first.get());
+    scheduler->register_thread(second.get());
+    scheduler->register_thread(third.get());
+    scheduler->select_initial_task();
+    ASSERT_EQ(first.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    scheduler->suspend_thread();
+    ASSERT_EQ(second.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    scheduler->suspend_thread();
+    ASSERT_EQ(third.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTests, test_time_slice_rotates_equal_priority_threads) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto first = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
+    auto second = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size);
+    auto third = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 3, stack, thread_stack_size);
+    scheduler->register_thread(first.get());
+    scheduler->register_thread(second.get());
+    scheduler->register_thread(third.get());
+    scheduler->policy().set_time_slice(3);
+    scheduler->select_initial_task();
+
+    scheduler->update_system_ticks(2);
+    scheduler->run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(first.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+
+    scheduler->update_system_ticks(1);
+    scheduler->run();
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(second.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+
+    pending_irq = false;
+    scheduler->update_system_ticks(3);
+    scheduler->run();
+    ASSERT_EQ(third.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+
+    pending_irq = false;
+    scheduler->update_system_ticks(3);
+    scheduler->run();
+    ASSERT_EQ(first.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    ASSERT_EQ(os::thread::status::pending, third->get_status());
+}
+
+TEST_F(SchedulerTests, test_time_slicing_disabled_by_default) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto first = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
+    auto second = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size);
+    scheduler->register_thread(first.get());
+    scheduler->register_thread(second.get());
+    scheduler->select_initial_task();
+    for ( int tick = 0; tick < 100; tick++ ) {
+        scheduler->update_system_ticks(1);
+        scheduler->run();
+    }
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(first.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTests, test_yield_switches_to_next_equal_priority_thread) {
+    uint32_t stack[thread_stack_size] = {0};
+    auto first = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
+    auto second = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size);
+    scheduler->register_thread(first.get());
+    scheduler->register_thread(second.get());
+    scheduler->select_initial_task();
+    scheduler->yield_thread();
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(second.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    ASSERT_EQ(os::thread::status::pending, first->get_status());
+    scheduler->yield_thread();
+    ASSERT_EQ(first.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTests, test_fixed_priority_policy_does_not_time_slice) {
+    os::static_scheduler<thread_count, os::fixed_priority_policy> fixed_scheduler(set_pending_irq, is_pending_irq);
+    uint32_t stack[thread_stack_size] = {0};
+    auto first = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
+    auto second = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size);
+    fixed_scheduler.set_internal_task(internal_thread.get());
+    fixed_scheduler.register_thread(first.get());
+    fixed_scheduler.register_thread(second.get());
+    fixed_scheduler.select_initial_task();
+    fixed_scheduler.update_system_ticks(1000);
+    fixed_scheduler.run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(first.get(), fixed_scheduler.get_active_tcb_ptr()->thread_ptr);
+
+    // Yielding still hands over to the next thread of the same priority
+    fixed_scheduler.yield_thread();
+    ASSERT_EQ(second.get(), fixed_scheduler.get_active_tcb_ptr()->thread_ptr);
+}
+
+/**
+ * \brief Minimal policy that always runs the most recently readied thread, used to check that the scheduler defers
+ *        every ordering decision to its policy
+*/
+class last_in_first_out_policy {
+public:
+    void on_ready(os::task_control_block *tcb) { m_ready.push_front(tcb); }
+    void on_block(os::task_control_block *tcb) { m_ready.remove(tcb); }
+    os::task_control_block *pick_next() const { return m_ready.front(); }
+    void on_tick(os::task_control_block *active, uint32_t now) { (void)active; (void)now; }
+    void on_dispatch(os::task_control_block *tcb, uint32_t now) { (void)tcb; (void)now; }
+
+private:
+    os::task_list<&os::task_control_block::ready_link> m_ready;
+};
+
+TEST_F(SchedulerTests, test_custom_policy_chooses_next_thread) {
+    os::static_scheduler<thread_count, last_in_first_out_policy> custom_scheduler(set_pending_irq, is_pending_irq);
+    uint32_t stack[thread_stack_size] = {0};
+    auto first = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 1, stack, thread_stack_size);
+    auto second = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), 2, stack, thread_stack_size);
+    custom_scheduler.set_internal_task(internal_thread.get());
+    custom_scheduler.register_thread(first.get());
+    custom_scheduler.register_thread(second.get());
+    custom_scheduler.select_initial_task();
+    ASSERT_EQ(second.get(), custom_scheduler.get_active_tcb_ptr()->thread_ptr);
+    custom_scheduler.suspend_thread();
+    ASSERT_EQ(first.get(), custom_scheduler.get_active_tcb_ptr()->thread_ptr);
+    custom_scheduler.resume_thread(custom_scheduler.get_task_by_id(2).value());
+    ASSERT_EQ(second.get(), custom_scheduler.get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_yield_without_equal_priority_thread_keeps_running) {
+    scheduler->select_initial_task();
+    scheduler->yield_thread();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_time_slice_does_not_rotate_to_lower_priority) {
+    scheduler->policy().set_time_slice(1);
+    scheduler->select_initial_task();
+    scheduler->update_system_ticks(5);
+    scheduler->run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_update_from_clock_triggers_context_switch) {
+    // Thread one sleeps, so the lower priority thread two runs until thread one wakes up and preempts it
+    scheduler->sleep_thread(1);
+    ASSERT_EQ(thread_two.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    pending_irq = false;
+    scheduler->update_system_ticks(1);
     scheduler->run();
     ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
     ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
 }
 
 TEST_F(SchedulerTestsWithPreRegisteredThreads, test_thread_sleep_wakes_up) {
     scheduler->sleep_thread(1);
-    clock.update(1);
+    pending_irq = false;
+    scheduler->update_system_ticks(1);
     scheduler->run();
     ASSERT_TRUE(pending_irq);
-    ASSERT_EQ(os::thread::status::pending, thread_one->get_status());
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
 }
 
-TEST_F(SchedulerTestsWithPreRegisteredThreads, test_multiple_threads_asleep_wakeup_at_the_same_time) {
-    scheduler->sleep_thread(1);    
-    auto tcb = scheduler->get_active_tcb_ptr(); 
-    tcb = tcb->next;
-    tcb->suspended_ticks_remaining = 1;
-    tcb->thread_ptr->set_status(os::thread::status::sleeping);
-
-    clock.update(1);
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_lower_priority_thread_does_not_preempt) {
+    // Thread two sleeps and wakes up while the higher priority thread one is still running
+    scheduler->suspend_thread();
+    scheduler->sleep_thread(1);
+    auto tcb = scheduler->get_task_by_id(1).value();
+    scheduler->resume_thread(tcb);
+    pending_irq = false;
     scheduler->run();
-    ASSERT_TRUE(pending_irq);
-    ASSERT_EQ(os::thread::status::pending, thread_one->get_status());
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    pending_irq = false;
+    scheduler->update_system_ticks(1);
+    scheduler->run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_multiple_threads_asleep_wakeup_at_the_same_time) {
+    scheduler->sleep_thread(1);
+    scheduler->sleep_thread(1);
+    ASSERT_EQ(internal_thread.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
 
-    // Reset the pending flag, and run the scheduler again. The second thread should now trigger
     pending_irq = false;
-    clock.update(1);
+    scheduler->update_system_ticks(1);
     scheduler->run();
     ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
     ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
 }
 
 TEST_F(SchedulerTestsWithPreRegisteredThreads, test_scheduler_doesnt_clobber_pending_request) {
-    // Sleep thread one with one tick remaining
-    scheduler->sleep_thread(1);    
-
-    // Manually sleep thread two as well
-    auto tcb = scheduler->get_active_tcb_ptr(); 
-    tcb = tcb->next;
-    tcb->suspended_ticks_remaining = 1;
-    tcb->thread_ptr->set_status(os::thread::status::sleeping);
-
-    // Run an update, which should pick up the first thread
-    clock.update(1);
-    scheduler->run();    
+    // Sleep both threads, leaving a context switch to the internal thread pending
+    scheduler->sleep_thread(1);
+    scheduler->sleep_thread(1);
+
+    // Both threads wake up, but the pending request is not re-targeted by the tick
+    scheduler->update_system_ticks(1);
+    scheduler->run();
     ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(internal_thread.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
     ASSERT_EQ(os::thread::status::pending, thread_one->get_status());
-    ASSERT_EQ(os::thread::status::active, thread_two->get_status());
+    ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
 
-    // Reset the pending flag, and run the scheduler again. The second thread should now trigger
+    // Once the pending switch has been serviced, the next update picks the highest priority thread
     pending_irq = false;
-    clock.update(1);
     scheduler->run();
     ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_resumed_thread_is_scheduled_by_priority) {
+    scheduler->suspend_thread();
+    ASSERT_EQ(thread_two.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    scheduler->resume_thread(scheduler->get_task_by_id(1).value());
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+
+    // The next scheduling pass has nothing left to do
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_resuming_higher_priority_thread_preempts_immediately) {
+    scheduler->suspend_thread();
+    pending_irq = false;
+    scheduler->resume_thread(scheduler->get_task_by_id(1).value());
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
     ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
 }
 
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_resuming_lower_priority_thread_does_not_preempt) {
+    // Thread two sleeps while thread one is suspended, then thread one is resumed and runs
+    scheduler->suspend_thread();
+    scheduler->sleep_thread(10);
+    scheduler->resume_thread(scheduler->get_task_by_id(1).value());
+    pending_irq = false;
+    scheduler->resume_thread(scheduler->get_task_by_id(2).value());
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(thread_one.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_resuming_thread_preempts_internal_thread) {
+    scheduler->suspend_thread();
+    scheduler->suspend_thread();
+    ASSERT_EQ(internal_thread.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    pending_irq = false;
+    scheduler->resume_thread(scheduler->get_task_by_id(2).value());
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(thread_two.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+}
+
 TEST_F(SchedulerTestsWithPreRegisteredThreads, test_handle_clock_rollover_with_suspended_thread) {
-    clock.update(0xFFFFFFFF);
+    scheduler->update_system_ticks(0xFFFFFFFF);
     scheduler->run();
     scheduler->sleep_thread(1);
-    clock.update(1);
+    pending_irq = false;
+    scheduler->update_system_ticks(1);
     scheduler->run();
     ASSERT_TRUE(pending_irq);
-    ASSERT_EQ(os::thread::status::pending, thread_one->get_status());
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_sleeping_threads_wake_in_wake_tick_order) {
+    scheduler->sleep_thread(5);
+    scheduler->sleep_thread(2);
+    scheduler->update_system_ticks(2);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(os::thread::status::active, thread_two->get_status());
+    ASSERT_EQ(os::thread::status::sleeping, thread_one->get_status());
+
+    scheduler->update_system_ticks(2);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(os::thread::status::sleeping, thread_one->get_status());
+
+    scheduler->update_system_ticks(1);
+    scheduler->run();
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_resumed_sleeping_thread_leaves_sleep_list) {
+    scheduler->sleep_thread(10);
+    scheduler->resume_thread(scheduler->get_task_by_id(1).value());
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+
+    // The original wake tick passing must not touch the now running thread
+    scheduler->update_system_ticks(10);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_ticks_until_next_wakeup) {
+    ASSERT_FALSE(scheduler->get_ticks_until_next_wakeup().has_value());
+    scheduler->sleep_thread(20);
+    scheduler->sleep_thread(10);
+    ASSERT_EQ(10, scheduler->get_ticks_until_next_wakeup().value());
+    scheduler->update_system_ticks(4);
+    ASSERT_EQ(6, scheduler->get_ticks_until_next_wakeup().value());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_tickless_idle_sleeps_until_next_wakeup) {
+    scheduler->sleep_thread(10);
+    scheduler->sleep_thread(20);
+    pending_irq = false;
+    fake_elapsed_ticks = UINT32_MAX;
+    scheduler->enter_tickless_idle(fake_suppress_ticks_and_sleep);
+    ASSERT_EQ(10, requested_idle_ticks);
+    ASSERT_EQ(10, scheduler->get_elapsed_ticks());
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+    ASSERT_EQ(os::thread::status::sleeping, thread_two->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_tickless_idle_woken_early_credits_elapsed_ticks) {
+    scheduler->sleep_thread(10);
+    scheduler->sleep_thread(20);
+    pending_irq = false;
+    fake_elapsed_ticks = 4;
+    scheduler->enter_tickless_idle(fake_suppress_ticks_and_sleep);
+    ASSERT_EQ(4, scheduler->get_elapsed_ticks());
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(6, scheduler->get_ticks_until_next_wakeup().value());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_tickless_idle_skipped_when_threads_are_ready) {
+    requested_idle_ticks = 0;
+    scheduler->sleep_thread(10);
+    scheduler->enter_tickless_idle(fake_suppress_ticks_and_sleep);
+    ASSERT_EQ(0, requested_idle_ticks);
+    ASSERT_EQ(0, scheduler->get_elapsed_ticks());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_tickless_idle_skipped_below_threshold) {
+    requested_idle_ticks = 0;
+    scheduler->sleep_thread(1);
+    scheduler->sleep_thread(5);
+    scheduler->enter_tickless_idle(fake_suppress_ticks_and_sleep);
+    ASSERT_EQ(0, requested_idle_ticks);
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_block_on_wait_queue_switches_to_next_thread) {
+    os::wait_queue queue;
+    scheduler->block_on(queue);
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(thread_two.get(), scheduler->get_active_tcb_ptr()->thread_ptr);
+    ASSERT_EQ(os::thread::status::suspended, thread_one->get_status());
+    ASSERT_EQ(scheduler->get_task_by_id(1).value(), queue.front());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_fifo_wait_queue_wakes_in_block_order) {
+    os::wait_queue queue;
+    scheduler->suspend_thread();
+    scheduler->block_on(queue);
+    scheduler->resume_thread(scheduler->get_task_by_id(1).value());
+    scheduler->block_on(queue);
+    ASSERT_EQ(scheduler->get_task_by_id(2).value(), scheduler->wake_one(queue));
+    ASSERT_EQ(scheduler->get_task_by_id(1).value(), scheduler->wake_one(queue));
+    ASSERT_EQ(nullptr, scheduler->wake_one(queue));
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_priority_wait_queue_wakes_highest_priority_first) {
+    os::wait_queue queue(os::wait_queue::order::priority);
+    scheduler->suspend_thread();
+    scheduler->block_on(queue);
+    scheduler->resume_thread(scheduler->get_task_by_id(1).value());
+    scheduler->block_on(queue);
+    ASSERT_EQ(scheduler->get_task_by_id(1).value(), scheduler->wake_one(queue));
+    ASSERT_EQ(scheduler->get_task_by_id(2).value(), scheduler->wake_one(queue));
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_wake_one_signals_waiting_thread) {
+    os::wait_queue queue;
+    auto* tcb = scheduler->get_task_by_id(1).value();
+    scheduler->block_on(queue);
+    pending_irq = false;
+    scheduler->wake_one(queue);
+    ASSERT_TRUE(queue.empty());
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(os::wait_result::signaled, tcb->wait_status);
+    ASSERT_EQ(nullptr, tcb->waiting_on);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_wake_all_wakes_every_waiting_thread) {
+    os::wait_queue queue;
+    scheduler->block_on(queue);
+    scheduler->block_on(queue);
+    ASSERT_EQ(2, scheduler->wake_all(queue));
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+    ASSERT_EQ(os::thread::status::pending, thread_two->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_timed_wait_times_out_and_leaves_wait_queue) {
+    os::wait_queue queue;
+    auto* tcb = scheduler->get_task_by_id(1).value();
+    scheduler->block_on(queue, 5);
+    ASSERT_EQ(os::thread::status::sleeping, thread_one->get_status());
+    scheduler->update_system_ticks(4);
+    scheduler->run();
+    ASSERT_EQ(tcb, queue.front());
+
+    pending_irq = false;
+    scheduler->update_system_ticks(1);
+    scheduler->run();
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(os::wait_result::timed_out, tcb->wait_status);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_signaled_timed_wait_leaves_sleep_list) {
+    os::wait_queue queue;
+    auto* tcb = scheduler->get_task_by_id(1).value();
+    scheduler->block_on(queue, 5);
+    scheduler->wake_one(queue);
+    ASSERT_EQ(os::wait_result::signaled, tcb->wait_status);
+    ASSERT_FALSE(scheduler->get_ticks_until_next_wakeup().has_value());
+
+    // The original timeout passing must not touch the now running thread
+    scheduler->update_system_ticks(5);
+    scheduler->run();
+    ASSERT_EQ(os::wait_result::signaled, tcb->wait_status);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_zero_timeout_wait_does_not_block) {
+    os::wait_queue queue;
+    auto* tcb = scheduler->get_task_by_id(1).value();
+    scheduler->block_on(queue, 0);
+    ASSERT_FALSE(pending_irq);
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(os::wait_result::timed_out, tcb->wait_status);
+    ASSERT_EQ(tcb, scheduler->get_active_tcb_ptr());
+    ASSERT_FALSE(scheduler->get_ticks_until_next_wakeup().has_value());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_timed_out_thread_is_not_woken_again) {
+    os::wait_queue queue;
+    auto* tcb = scheduler->get_task_by_id(1).value();
+    scheduler->block_on(queue, 2);
+    scheduler->update_system_ticks(2);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(nullptr, scheduler->wake_one(queue));
+    ASSERT_EQ(os::wait_result::timed_out, tcb->wait_status);
+    ASSERT_EQ(os::thread::status::active, thread_one->get_status());
+}
+
+TEST_F(SchedulerTestsWithPreRegisteredThreads, test_resuming_waiting_thread_interrupts_wait) {
+    os::wait_queue queue;
+    auto* tcb = scheduler->get_task_by_id(1).value();
+    scheduler->block_on(queue);
+    scheduler->resume_thread(tcb);
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(os::wait_result::interrupted, tcb->wait_status);
 }
@@ -1,96 +1,184 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // SPDX-FileCopyrightText: 2023 Graham Riches
 
-
 /********************************** Includes *******************************************/
 #include "gtest/gtest.h"
-#include "thread_impl.h"
-#include "system_clock.h"
-#include "scheduler_impl.h"
-#include "semaphore_impl.h"
-#include "common.h"
-#include <iostream>
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "semaphore.hpp"
 #include <memory>
 
 
 /*********************************** Consts ********************************************/
-constexpr uint16_t thread_stack_size = 512;
-constexpr uint8_t thread_count = 3;
-
-/************************************ Local Variables ********************************************/
-static bool pending_irq;
-
-/************************************ Local Functions ********************************************/
-/**
- * \brief test setting a fake pending IRQ in a c-style callback so that the API to the PendSV handler
- *        is somewhat tested
-*/
-static void set_pending_irq(){
-    pending_irq = true;
-}
-
-/**
- * \brief function to check if an interrupt is already pending
- * \return returns true if a request is already pending
-*/
-static bool is_pending_irq(){
-    return pending_irq;
-}
+constexpr uint8_t thread_count = 4;
 
 /************************************ Test Fixtures ********************************************/
 /**
-* \brief test fixture class for testing semaphore mechanism
+* \brief test fixture for the counting semaphore. The semaphore calls act on behalf of whichever thread the scheduler
+*        has made active, so each test drives the threads by suspending and resuming them. Thread priorities are
+*        high = 1, medium = 3, and low = 5. The low priority thread starts out active and the semaphore starts empty.
 */
-class semaphore_tests : public ::testing::Test {
-
-using counting_semaphore = os::counting_semaphore<uint8_t>;
-
+class SemaphoreTests : public ::testing::Test {
 protected:
-    static void thread_task(void *arguments){ PARAMETER_NOT_USED(arguments); };    
-
     void SetUp(void) override {
-        //!< setup the scheduler and system clock
-        internal_thread = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), nullptr, 0xFFFF, internal_stack, thread_stack_size);
-        scheduler = std::make_unique<os::scheduler_impl>(&clock, thread_count, set_pending_irq, is_pending_irq);
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        internal_thread = make_internal_thread(internal_stack);
+        low = make_thread(1, low_stack, 5);
+        medium = make_thread(2, medium_stack, 3);
+        high = make_thread(3, high_stack, 1);
         scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(low.get());
+        scheduler->register_thread(medium.get());
+        scheduler->register_thread(high.get());
+        low_tcb = scheduler->get_task_by_id(1).value();
+        medium_tcb = scheduler->get_task_by_id(2).value();
+        high_tcb = scheduler->get_task_by_id(3).value();
+
+        // Park the higher priority threads so that the low priority thread runs first
+        scheduler->select_initial_task();
+        scheduler->suspend_thread();
+        scheduler->suspend_thread();
+        semaphore = std::make_unique<counting_semaphore>(*scheduler, 0);
         pending_irq = false;
-        clock.start();
-
-        //!< register two threads with the scheduler
-
-        //!< TODO: you are here
-        /*
-            - create simple threading object that takes a semaphore pointer, and has an internal thread + stack etc
-            - add functions to acquire and release the semaphore
-            - create those objects here and use in tests.
-        */
-
-
-        internal_thread = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), nullptr, 1, thread_one_stack, thread_stack_size);
-        internal_thread = create_thread(reinterpret_cast<os::thread::task_pointer>(&thread_task), nullptr, 2, thread_two_stack, thread_stack_size);
-
-        //!< setup the semaphore
-        semaphore = std::make_unique<counting_semaphore>(scheduler.get(), 1, 3);
     }
 
 public:
+    using counting_semaphore = os::counting_semaphore<4>;
+
     uint32_t internal_stack[thread_stack_size] = {0};
-    uint32_t thread_one_stack[thread_stack_size] = {0};
-    uint32_t thead_two_stack[thread_stack_size] = {0};
+    uint32_t low_stack[thread_stack_size] = {0};
+    uint32_t medium_stack[thread_stack_size] = {0};
+    uint32_t high_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
     std::unique_ptr<os::thread> internal_thread;
-    std::unique_ptr<os::thread> task_thread_one;
-    std::unique_ptr<os::thread> task_thread_two;
-    std::unique_ptr<os::scheduler_impl> scheduler;
+    std::unique_ptr<os::thread> low;
+    std::unique_ptr<os::thread> medium;
+    std::unique_ptr<os::thread> high;
     std::unique_ptr<counting_semaphore> semaphore;
-    os::system_clock clock;
-        
-    std::unique_ptr<os::thread> create_thread(os::thread::task_pointer task_ptr, void *args, uint32_t thread_id, uint32_t *stack_ptr, uint32_t stack_size) {
-        return std::make_unique<os::thread>(task_ptr, args, thread_id, stack_ptr, stack_size);
+    os::task_control_block* low_tcb;
+    os::task_control_block* medium_tcb;
+    os::task_control_block* high_tcb;
+
+    os::task_control_block* active() {
+        return scheduler->get_active_tcb_ptr();
     }
 };
 
-/************************************ Unit Tests ********************************************/
 
-TEST_F(semaphore_tests, test_wait_on_semaphore_with_resource_available_does_not_suspend) {
-    
-}
\ No newline at end of file
+/************************************ Tests ********************************************/
+TEST_F(SemaphoreTests, test_acquire_with_a_unit_available_does_not_block) {
+    semaphore->release();
+    semaphore->acquire();
+    ASSERT_EQ(low_tcb, active());
+    ASSERT_FALSE(pending_irq);
+    ASSERT_FALSE(semaphore->try_acquire());
+}
+
+TEST_F(SemaphoreTests, test_waiters_are_woken_in_fifo_order) {
+    // Medium blocks before high, so it is handed the first unit even though high outranks it
+    scheduler->resume_thread(medium_tcb);
+    semaphore->acquire();
+    scheduler->resume_thread(high_tcb);
+    semaphore->acquire();
+    ASSERT_EQ(low_tcb, active());
+    ASSERT_EQ(os::thread::status::suspended, medium->get_status());
+    ASSERT_EQ(os::thread::status::suspended, high->get_status());
+
+    semaphore->release();
+    ASSERT_EQ(medium_tcb, active());
+    ASSERT_EQ(os::wait_result::signaled, medium_tcb->wait_status);
+    ASSERT_EQ(os::thread::status::suspended, high->get_status());
+
+    semaphore->release();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::signaled, high_tcb->wait_status);
+    ASSERT_FALSE(semaphore->try_acquire());
+}
+
+TEST_F(SemaphoreTests, test_release_hands_units_to_waiters_before_the_count_grows) {
+    scheduler->resume_thread(medium_tcb);
+    semaphore->acquire();
+    scheduler->resume_thread(high_tcb);
+    semaphore->acquire();
+
+    // Two of the three units go straight to the waiters, so only one is left for a thread that never blocked
+    semaphore->release(3);
+    ASSERT_EQ(os::wait_result::signaled, medium_tcb->wait_status);
+    ASSERT_EQ(os::wait_result::signaled, high_tcb->wait_status);
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_TRUE(semaphore->try_acquire());
+    ASSERT_FALSE(semaphore->try_acquire());
+}
+
+TEST_F(SemaphoreTests, test_release_clamps_the_count_to_the_max) {
+    semaphore->release(10);
+    for ( int i = 0; i < semaphore->max(); i++ ) {
+        ASSERT_TRUE(semaphore->try_acquire());
+    }
+    ASSERT_FALSE(semaphore->try_acquire());
+}
+
+TEST_F(SemaphoreTests, test_try_acquire_for_timeout_removes_the_waiter) {
+    scheduler->resume_thread(high_tcb);
+    // On the host the call returns as soon as high is parked, before the wait has an outcome
+    (void)semaphore->try_acquire_for(5);
+    ASSERT_EQ(os::thread::status::sleeping, high->get_status());
+    ASSERT_EQ(low_tcb, active());
+
+    scheduler->update_system_ticks(5);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::timed_out, high_tcb->wait_status);
+
+    // The timed out thread no longer waits, so the next unit adds to the count instead of being handed to it
+    semaphore->release();
+    ASSERT_EQ(os::wait_result::timed_out, high_tcb->wait_status);
+    ASSERT_TRUE(semaphore->try_acquire());
+}
+
+TEST_F(SemaphoreTests, test_try_acquire_for_is_handed_a_unit_released_inside_the_window) {
+    scheduler->resume_thread(high_tcb);
+    (void)semaphore->try_acquire_for(5);
+    ASSERT_EQ(low_tcb, active());
+
+    semaphore->release();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::signaled, high_tcb->wait_status);
+
+    // The wake up cancels the timeout, so it does not fire later
+    scheduler->update_system_ticks(5);
+    scheduler->run();
+    ASSERT_EQ(os::wait_result::signaled, high_tcb->wait_status);
+    ASSERT_FALSE(semaphore->try_acquire());
+}
+
+TEST_F(SemaphoreTests, test_try_acquire_until_a_passed_deadline_does_not_block) {
+    scheduler->update_system_ticks(10);
+    ASSERT_FALSE(semaphore->try_acquire_until(5));
+    ASSERT_FALSE(semaphore->try_acquire_until(10));
+    ASSERT_EQ(low_tcb, active());
+    ASSERT_EQ(os::thread::status::active, low->get_status());
+    ASSERT_EQ(os::wait_result::timed_out, low_tcb->wait_status);
+    ASSERT_FALSE(pending_irq);
+
+    // An available unit is still taken
+    semaphore->release();
+    ASSERT_TRUE(semaphore->try_acquire_until(5));
+}
+
+TEST_F(SemaphoreTests, test_try_acquire_until_a_future_deadline_waits_until_that_tick) {
+    scheduler->update_system_ticks(10);
+    scheduler->resume_thread(high_tcb);
+    (void)semaphore->try_acquire_until(15);
+    ASSERT_EQ(os::thread::status::sleeping, high->get_status());
+
+    scheduler->update_system_ticks(4);
+    scheduler->run();
+    ASSERT_EQ(os::thread::status::sleeping, high->get_status());
+    scheduler->update_system_ticks(1);
+    pending_irq = false;
+    scheduler->run();
+    ASSERT_EQ(high_tcb, active());
+    ASSERT_EQ(os::wait_result::timed_out, high_tcb->wait_status);
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "spsc_ring_buffer.hpp"
+#include "gtest/gtest.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+
+/*********************************** Test Fixtures ********************************************/
+/**
+ * \brief test fixture for single producer, single consumer ring buffer tests
+ */
+class SpscRingBufferTests : public ::testing::Test {
+  public:
+    void SetUp() override { }
+
+    void TearDown() override { }
+
+    spsc_ring_buffer<int, 4> buffer;
+};
+
+/************************************ Tests ********************************************/
+TEST_F(SpscRingBufferTests, test_initial_construction) {
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_FALSE(buffer.full());
+    ASSERT_EQ(0, buffer.size());
+    ASSERT_EQ(4, buffer.capacity());
+    ASSERT_FALSE(buffer.pop().has_value());
+}
+
+TEST_F(SpscRingBufferTests, test_items_pop_in_push_order) {
+    ASSERT_TRUE(buffer.push(1));
+    ASSERT_TRUE(buffer.push(2));
+    ASSERT_TRUE(buffer.push(3));
+    ASSERT_EQ(3, buffer.size());
+    ASSERT_EQ(1, buffer.pop().value());
+    ASSERT_EQ(2, buffer.pop().value());
+    ASSERT_EQ(3, buffer.pop().value());
+    ASSERT_TRUE(buffer.empty());
+}
+
+TEST_F(SpscRingBufferTests, test_push_to_full_buffer_fails_without_overwriting) {
+    for ( int i = 0; i < 4; i++ ) {
+        ASSERT_TRUE(buffer.push(i));
+    }
+    ASSERT_TRUE(buffer.full());
+    ASSERT_FALSE(buffer.push(99));
+    for ( int i = 0; i < 4; i++ ) {
+        ASSERT_EQ(i, buffer.pop().value());
+    }
+}
+
+TEST_F(SpscRingBufferTests, test_items_stay_in_order_across_wraps) {
+    int next_push = 0;
+    int next_pop = 0;
+    for ( int lap = 0; lap < 10; lap++ ) {
+        ASSERT_TRUE(buffer.push(next_push++));
+        ASSERT_TRUE(buffer.push(next_push++));
+        ASSERT_TRUE(buffer.push(next_push++));
+        ASSERT_EQ(next_pop++, buffer.pop().value());
+        ASSERT_EQ(next_pop++, buffer.pop().value());
+        ASSERT_EQ(next_pop++, buffer.pop().value());
+    }
+    ASSERT_TRUE(buffer.empty());
+}
+
+TEST_F(SpscRingBufferTests, test_move_only_push_moves_the_item) {
+    spsc_ring_buffer<std::unique_ptr<int>, 2> pointers;
+    ASSERT_TRUE(pointers.push(std::make_unique<int>(7)));
+    auto value = pointers.pop();
+    ASSERT_TRUE(value.has_value());
+    ASSERT_EQ(7, *value.value());
+}
+
+TEST_F(SpscRingBufferTests, test_concurrent_producer_and_consumer_deliver_every_item_in_order) {
+    constexpr uint32_t item_count = 200000;
+    static spsc_ring_buffer<uint32_t, 64> shared;
+
+    std::thread producer([]() {
+        for ( uint32_t i = 0; i < item_count; i++ ) {
+            while ( !shared.push(i) ) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    while ( expected < item_count ) {
+        auto value = shared.pop();
+        if ( !value.has_value() ) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(expected, value.value());
+        expected++;
+    }
+    producer.join();
+    ASSERT_TRUE(shared.empty());
+}
+
+TEST_F(SpscRingBufferTests, test_bulk_push_stops_when_full) {
+    std::array<int, 6> values = {1, 2, 3, 4, 5, 6};
+    ASSERT_EQ(4, buffer.push(std::span<const int>(values)));
+    ASSERT_TRUE(buffer.full());
+    ASSERT_EQ(0, buffer.push(std::span<const int>(values)));
+}
+
+TEST_F(SpscRingBufferTests, test_bulk_push_and_pop_wrap_in_order) {
+    ASSERT_TRUE(buffer.push(0));
+    ASSERT_TRUE(buffer.push(0));
+    buffer.pop();
+    buffer.pop();
+    std::array<int, 4> values = {1, 2, 3, 4};
+    ASSERT_EQ(4, buffer.push(std::span<const int>(values)));
+
+    std::array<int, 3> destination = {};
+    ASSERT_EQ(3, buffer.pop(std::span<int>(destination)));
+    ASSERT_EQ((std::array<int, 3>{1, 2, 3}), destination);
+    ASSERT_EQ(1, buffer.pop(std::span<int>(destination)));
+    ASSERT_EQ(4, destination[0]);
+    ASSERT_EQ(0, buffer.pop(std::span<int>(destination)));
+}
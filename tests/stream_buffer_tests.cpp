@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "stream_buffer.hpp"
+#include <array>
+#include <memory>
+#include <span>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 2;
+constexpr std::size_t buffer_capacity = 8;
+using message_status = os::stream_buffer<buffer_capacity>::message_status;
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for stream buffers. The reader (priority 1) starts out active and the writer (priority 2) runs
+*        whenever the reader is blocked.
+*/
+class StreamBufferTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        scheduler->policy().set_time_slice(0);
+        internal_thread = make_internal_thread(internal_stack);
+        reader = make_thread(0, reader_stack, 1);
+        writer = make_thread(1, writer_stack, 2);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(reader.get());
+        scheduler->register_thread(writer.get());
+        reader_tcb = scheduler->get_task_by_id(0).value();
+        writer_tcb = scheduler->get_task_by_id(1).value();
+        scheduler->select_initial_task();
+        buffer = std::make_unique<os::stream_buffer<buffer_capacity>>(*scheduler);
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t reader_stack[thread_stack_size] = {0};
+    uint32_t writer_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> reader;
+    std::unique_ptr<os::thread> writer;
+    std::unique_ptr<os::stream_buffer<buffer_capacity>> buffer;
+    os::task_control_block* reader_tcb;
+    os::task_control_block* writer_tcb;
+
+};
+
+/************************************ Unit Tests ********************************************/
+TEST_F(StreamBufferTests, test_bytes_are_received_in_send_order_across_the_wrap) {
+    std::array<uint8_t, 6> data = {1, 2, 3, 4, 5, 6};
+    std::array<uint8_t, 8> destination{};
+    ASSERT_EQ(6u, buffer->try_send(data));
+    ASSERT_EQ(4u, buffer->try_receive(std::span(destination).first(4)));
+    ASSERT_EQ(4, destination[3]);
+
+    // Only the free space is written when the data does not fit
+    std::array<uint8_t, 8> more = {7, 8, 9, 10, 11, 12, 13, 14};
+    ASSERT_EQ(6u, buffer->try_send(more));
+    ASSERT_EQ(8u, buffer->size());
+    ASSERT_EQ(0u, buffer->try_send(more));
+    ASSERT_EQ(8u, buffer->receive(destination));
+    std::array<uint8_t, 8> expected = {5, 6, 7, 8, 9, 10, 11, 12};
+    ASSERT_EQ(expected, destination);
+    ASSERT_TRUE(buffer->empty());
+}
+
+TEST_F(StreamBufferTests, test_reader_only_wakes_at_the_trigger_level) {
+    buffer->set_trigger_level(4);
+    std::array<uint8_t, 8> destination{};
+    ASSERT_EQ(0u, buffer->receive(destination, 10));
+    ASSERT_EQ(reader->get_status(), os::thread::status::sleeping);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), writer_tcb);
+
+    // Bytes below the trigger level do not wake the reader
+    pending_irq = false;
+    std::array<uint8_t, 2> data = {1, 2};
+    ASSERT_EQ(2u, buffer->try_send(data));
+    ASSERT_EQ(1u, buffer->try_send(std::span(data).first(1)));
+    ASSERT_FALSE(pending_irq);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), writer_tcb);
+
+    ASSERT_EQ(1u, buffer->try_send(std::span(data).last(1)));
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+    ASSERT_EQ(reader_tcb->wait_status, os::wait_result::signaled);
+    ASSERT_EQ(4u, buffer->try_receive(destination));
+}
+
+TEST_F(StreamBufferTests, test_receive_returns_bytes_below_the_trigger_level_on_timeout) {
+    buffer->set_trigger_level(4);
+    std::array<uint8_t, 2> data = {1, 2};
+    std::array<uint8_t, 8> destination{};
+    ASSERT_EQ(2u, buffer->try_send(data));
+    ASSERT_EQ(2u, buffer->receive(destination, 0));
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+    ASSERT_EQ(2, destination[1]);
+}
+
+TEST_F(StreamBufferTests, test_trigger_level_is_clamped) {
+    buffer->set_trigger_level(0);
+    std::array<uint8_t, 1> data = {1};
+    std::array<uint8_t, 8> destination{};
+    ASSERT_EQ(1u, buffer->try_send(data));
+    ASSERT_EQ(1u, buffer->receive(destination, 0));
+
+    // A trigger level above the capacity still wakes the reader once the buffer is full
+    buffer->set_trigger_level(100);
+    ASSERT_EQ(0u, buffer->receive(destination, 10));
+    std::array<uint8_t, 8> fill{};
+    ASSERT_EQ(8u, buffer->try_send(fill));
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+}
+
+TEST_F(StreamBufferTests, test_send_blocks_while_full_until_bytes_are_read) {
+    std::array<uint8_t, 10> data = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    ASSERT_EQ(8u, buffer->send(data));
+    ASSERT_EQ(reader->get_status(), os::thread::status::suspended);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), writer_tcb);
+
+    std::array<uint8_t, 2> destination{};
+    ASSERT_EQ(2u, buffer->try_receive(destination));
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+    ASSERT_EQ(reader_tcb->wait_status, os::wait_result::signaled);
+}
+
+TEST_F(StreamBufferTests, test_messages_are_received_whole) {
+    std::array<uint8_t, 3> first = {1, 2, 3};
+    std::array<uint8_t, 1> second = {4};
+    ASSERT_TRUE(buffer->send_message(first));
+    ASSERT_TRUE(buffer->try_send_message(second));
+    ASSERT_EQ(8u, buffer->size());
+    ASSERT_FALSE(buffer->try_send_message(std::span<const uint8_t>()));
+    ASSERT_EQ(3u, buffer->next_message_size());
+
+    // A message larger than the destination stays in the buffer
+    std::array<uint8_t, 2> small{};
+    std::array<uint8_t, 6> destination{};
+    auto result = buffer->try_receive_message(small);
+    ASSERT_EQ(message_status::too_large, result.status);
+    ASSERT_EQ(3u, result.size);
+    result = buffer->receive_message(destination);
+    ASSERT_EQ(message_status::received, result.status);
+    ASSERT_EQ(3u, result.size);
+    ASSERT_EQ(3, destination[2]);
+    result = buffer->try_receive_message(small);
+    ASSERT_EQ(message_status::received, result.status);
+    ASSERT_EQ(1u, result.size);
+    ASSERT_EQ(4, small[0]);
+    ASSERT_EQ(message_status::no_message, buffer->try_receive_message(destination).status);
+}
+
+TEST_F(StreamBufferTests, test_message_length_prefix_wraps) {
+    std::array<uint8_t, 5> first = {1, 2, 3, 4, 5};
+    std::array<uint8_t, 2> second = {6, 7};
+    std::array<uint8_t, 6> destination{};
+    ASSERT_TRUE(buffer->try_send_message(first));
+    ASSERT_EQ(5u, buffer->try_receive_message(destination).size);
+
+    // The prefix of the next message is split over the last and first bytes of the storage
+    ASSERT_TRUE(buffer->try_send_message(second));
+    ASSERT_EQ(2u, buffer->next_message_size());
+    ASSERT_EQ(2u, buffer->try_receive_message(destination).size);
+    ASSERT_EQ(7, destination[1]);
+}
+
+TEST_F(StreamBufferTests, test_oversized_messages_are_rejected) {
+    std::array<uint8_t, 7> data{};
+    ASSERT_EQ(6u, os::stream_buffer<buffer_capacity>::max_message_size);
+    ASSERT_FALSE(buffer->try_send_message(data));
+    ASSERT_FALSE(buffer->send_message(data, 0));
+    ASSERT_TRUE(buffer->empty());
+}
+
+TEST_F(StreamBufferTests, test_empty_messages_are_rejected) {
+    ASSERT_FALSE(buffer->try_send_message(std::span<const uint8_t>()));
+    ASSERT_FALSE(buffer->send_message(std::span<const uint8_t>(), 0));
+    ASSERT_TRUE(buffer->empty());
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+}
+
+TEST_F(StreamBufferTests, test_message_too_large_for_destination_is_not_a_timeout) {
+    std::array<uint8_t, 4> data = {1, 2, 3, 4};
+    std::array<uint8_t, 2> small{};
+    ASSERT_TRUE(buffer->try_send_message(data));
+
+    // The reader is told the size it needs instead of blocking on a message that never fits
+    auto result = buffer->receive_message(small, 10);
+    ASSERT_EQ(message_status::too_large, result.status);
+    ASSERT_EQ(4u, result.size);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+    ASSERT_EQ(4u, buffer->next_message_size());
+
+    // Dropping the message leaves the buffer empty, so the next read times out instead
+    ASSERT_TRUE(buffer->discard_message());
+    ASSERT_TRUE(buffer->empty());
+    ASSERT_FALSE(buffer->discard_message());
+    result = buffer->receive_message(small, 10);
+    ASSERT_EQ(message_status::no_message, result.status);
+    ASSERT_EQ(0u, result.size);
+    ASSERT_EQ(reader->get_status(), os::thread::status::sleeping);
+}
+
+TEST_F(StreamBufferTests, test_receive_message_blocks_until_a_message_is_sent) {
+    std::array<uint8_t, 4> destination{};
+    ASSERT_EQ(message_status::no_message, buffer->receive_message(destination, 10).status);
+    ASSERT_EQ(reader->get_status(), os::thread::status::sleeping);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), writer_tcb);
+
+    pending_irq = false;
+    std::array<uint8_t, 2> data = {1, 2};
+    ASSERT_TRUE(buffer->try_send_message(data));
+    ASSERT_TRUE(pending_irq);
+    ASSERT_EQ(scheduler->get_active_tcb_ptr(), reader_tcb);
+    ASSERT_EQ(reader_tcb->wait_status, os::wait_result::signaled);
+    ASSERT_EQ(2u, buffer->try_receive_message(destination).size);
+}
+
+TEST_F(StreamBufferTests, test_try_calls_keep_the_callers_interrupt_state) {
+    // A UART handler running with interrupts masked writes without unmasking them
+    std::array<uint8_t, 2> data = {1, 2};
+    std::array<uint8_t, 4> destination{};
+    DISABLE_INTERRUPTS();
+    auto enables = os::port::interrupt_enable_count;
+    ASSERT_EQ(2u, buffer->try_send(data));
+    ASSERT_EQ(2u, buffer->try_receive(destination));
+    ASSERT_TRUE(buffer->try_send_message(data));
+    ASSERT_EQ(2u, buffer->try_receive_message(destination).size);
+    EXPECT_TRUE(os::port::interrupts_masked);
+    EXPECT_EQ(enables, os::port::interrupt_enable_count);
+    ENABLE_INTERRUPTS();
+
+    // Called with interrupts enabled, they are enabled again afterwards
+    ASSERT_EQ(2u, buffer->try_send(data));
+    EXPECT_FALSE(os::port::interrupts_masked);
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+#pragma once
+
+/********************************** Includes *******************************************/
+#include "thread.hpp"
+#include <cstdint>
+#include <memory>
+
+/*********************************** Consts ********************************************/
+//!< Stack size in words of the threads made by the tests
+constexpr uint16_t thread_stack_size = 128;
+
+//!< Id given to the internal idle thread
+constexpr uint32_t internal_thread_id = 0xFFFF;
+
+/************************************ Shared Variables ********************************************/
+//!< Set by the fake PendSV hook whenever the scheduler requests a context switch. Tests clear it before each step
+inline bool pending_irq = false;
+
+//!< Number of context switches requested through the fake PendSV hook. Tests that count switches reset it in SetUp
+inline unsigned context_switches = 0;
+
+/************************************ Shared Functions ********************************************/
+/**
+ * \brief fake pending IRQ for the PendSV handler that counts the requested context switches
+*/
+inline void set_pending_irq(){
+    pending_irq = true;
+    context_switches++;
+}
+
+/**
+ * \brief function to check if an interrupt is already pending
+ * \return returns true if a request is already pending
+*/
+inline bool is_pending_irq(){
+    return pending_irq;
+}
+
+/**
+ * \brief task function of the test threads, which are never really run
+*/
+inline void thread_task(void *arguments){
+    (void)(arguments);
+}
+
+/**
+ * \brief make a test thread running thread_task on a stack of thread_stack_size words
+ *
+ * \param thread_id Id of the thread
+ * \param stack_ptr The stack of the thread
+ * \param priority Priority of the thread
+ * \return the thread
+*/
+inline std::unique_ptr<os::thread> make_thread(uint32_t thread_id, uint32_t *stack_ptr, uint32_t priority = os::thread::lowest_priority) {
+    return std::make_unique<os::thread>(reinterpret_cast<os::thread::task_pointer>(&thread_task), thread_id, stack_ptr, thread_stack_size, priority);
+}
+
+/**
+ * \brief make the internal idle thread for a test scheduler
+ *
+ * \param stack_ptr The stack of the thread
+ * \return the thread
+*/
+inline std::unique_ptr<os::thread> make_internal_thread(uint32_t *stack_ptr) {
+    return make_thread(internal_thread_id, stack_ptr, os::thread::lowest_priority);
+}
@@ -72,6 +72,14 @@ TEST_F(ThreadingTests, test_initial_stack_context_is_valid){
     ASSERT_EQ( static_cast<uint32_t>(reinterpret_cast<std::uintptr_t>(&thread_task)), context->pc);
 }
 
+TEST_F(ThreadingTests, test_initial_stack_context_is_short_frame){
+    // New threads have no FPU context, so only the integer registers and EXC_RETURN are reserved
+    uint32_t *stack_context_ptr = thread->get_stack_ptr();
+    os::thread::register_context* context = reinterpret_cast<os::thread::register_context*>(stack_context_ptr);
+    ASSERT_EQ(thread_stack.get() + thread_stack_size - 17, stack_context_ptr);
+    ASSERT_EQ(0xFFFFFFFD, context->exc_return);
+}
+
 TEST_F(ThreadingDeathsTests, creating_thread_with_null_task_ptr_fails){    
     ASSERT_DEATH({create_thread(nullptr, 1, thread_stack.get(), thread_stack_size);}, "");
 }
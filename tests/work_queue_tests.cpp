@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2023 Graham Riches
+
+/********************************** Includes *******************************************/
+#include "gtest/gtest.h"
+#include "test_threads.hpp"
+#include "scheduler_impl.hpp"
+#include "work_queue.hpp"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+/*********************************** Consts ********************************************/
+constexpr uint8_t thread_count = 2;
+constexpr std::size_t queue_capacity = 16;
+
+/************************************ Local Functions ********************************************/
+/**
+ * \brief work item that records its argument in a log
+ */
+static std::vector<uintptr_t> work_log;
+static void record_work(void* argument) {
+    work_log.push_back(reinterpret_cast<uintptr_t>(argument));
+}
+
+/************************************ Test Fixtures ********************************************/
+/**
+* \brief test fixture for the deferred work queue. The worker thread is the active thread, and each test runs the
+*        worker by draining the queue directly.
+*/
+class WorkQueueTests : public ::testing::Test {
+protected:
+    void SetUp(void) override {
+        scheduler = std::make_unique<os::static_scheduler<thread_count>>(set_pending_irq, is_pending_irq);
+        internal_thread = make_internal_thread(internal_stack);
+        worker_thread = make_thread(1, worker_stack);
+        scheduler->set_internal_task(internal_thread.get());
+        scheduler->register_thread(worker_thread.get());
+        scheduler->select_initial_task();
+        queue = std::make_unique<os::work_queue<queue_capacity>>(*scheduler);
+        work_log.clear();
+        pending_irq = false;
+    }
+
+public:
+    uint32_t internal_stack[thread_stack_size] = {0};
+    uint32_t worker_stack[thread_stack_size] = {0};
+    std::unique_ptr<os::static_scheduler<thread_count>> scheduler;
+    std::unique_ptr<os::thread> internal_thread;
+    std::unique_ptr<os::thread> worker_thread;
+    std::unique_ptr<os::work_queue<queue_capacity>> queue;
+
+    static void* as_argument(uintptr_t value) {
+        return reinterpret_cast<void*>(value);
+    }
+};
+
+
+/************************************ Tests ********************************************/
+TEST_F(WorkQueueTests, test_work_runs_in_post_order) {
+    ASSERT_TRUE(queue->post(record_work, as_argument(1)));
+    ASSERT_TRUE(queue->post(record_work, as_argument(2)));
+    ASSERT_TRUE(queue->post(record_work, as_argument(3)));
+    ASSERT_TRUE(work_log.empty());
+    ASSERT_EQ(3, queue->drain(queue_capacity));
+    ASSERT_EQ(std::vector<uintptr_t>({1, 2, 3}), work_log);
+    ASSERT_EQ(0, queue->drain(queue_capacity));
+}
+
+TEST_F(WorkQueueTests, test_drain_is_limited_to_batch) {
+    for ( uintptr_t i = 0; i < 5; i++ ) {
+        queue->post(record_work, as_argument(i));
+    }
+    ASSERT_EQ(2, queue->drain(2));
+    ASSERT_EQ(std::vector<uintptr_t>({0, 1}), work_log);
+    ASSERT_EQ(3, queue->drain(8));
+    ASSERT_EQ(std::vector<uintptr_t>({0, 1, 2, 3, 4}), work_log);
+}
+
+TEST_F(WorkQueueTests, test_full_queue_counts_overflows) {
+    for ( uintptr_t i = 0; i < queue_capacity; i++ ) {
+        ASSERT_TRUE(queue->post(record_work, as_argument(i)));
+    }
+    ASSERT_FALSE(queue->post(record_work, as_argument(99)));
+    ASSERT_FALSE(queue->post(record_work, as_argument(99)));
+    ASSERT_EQ(2, queue->get_overflow_count());
+
+    // Draining frees the slots for the next lap around the queue
+    ASSERT_EQ(queue_capacity, queue->drain(queue_capacity));
+    ASSERT_TRUE(queue->post(record_work, as_argument(100)));
+    ASSERT_EQ(1, queue->drain(queue_capacity));
+    ASSERT_EQ(100, work_log.back());
+    ASSERT_EQ(2, queue->get_overflow_count());
+}
+
+TEST_F(WorkQueueTests, test_work_can_post_more_work) {
+    static os::work_queue<queue_capacity>* self;
+    self = queue.get();
+    queue->post([](void* argument) {
+        record_work(argument);
+        self->post(record_work, as_argument(2));
+    }, as_argument(1));
+    ASSERT_EQ(2, queue->drain(queue_capacity));
+    ASSERT_EQ(std::vector<uintptr_t>({1, 2}), work_log);
+}
+
+TEST_F(WorkQueueTests, test_post_keeps_the_callers_interrupt_state) {
+    // Posting from a handler that runs with interrupts masked must not unmask them when it wakes the worker
+    DISABLE_INTERRUPTS();
+    auto enables = os::port::interrupt_enable_count;
+    ASSERT_TRUE(queue->post(record_work, as_argument(1)));
+    EXPECT_TRUE(os::port::interrupts_masked);
+    EXPECT_EQ(enables, os::port::interrupt_enable_count);
+    ENABLE_INTERRUPTS();
+
+    // Posting with interrupts enabled leaves them enabled
+    os::work_queue<queue_capacity> other(*scheduler);
+    ASSERT_TRUE(other.post(record_work, as_argument(2)));
+    EXPECT_FALSE(os::port::interrupts_masked);
+}
+
+TEST_F(WorkQueueTests, test_concurrent_producers_deliver_every_item_in_order) {
+    constexpr std::size_t producer_count = 4;
+    constexpr uintptr_t items_per_producer = 5000;
+    static std::array<std::vector<uintptr_t>, producer_count> received;
+    for ( auto& log : received ) {
+        log.clear();
+    }
+    auto receive = [](void* argument) {
+        auto value = reinterpret_cast<uintptr_t>(argument);
+        received[value / items_per_producer].push_back(value % items_per_producer);
+    };
+
+    std::vector<std::thread> producers;
+    for ( std::size_t producer = 0; producer < producer_count; producer++ ) {
+        producers.emplace_back([this, producer, receive]() {
+            for ( uintptr_t i = 0; i < items_per_producer; i++ ) {
+                // Retry work that overflowed, as the consumer is draining concurrently
+                while ( !queue->post(receive, as_argument(producer * items_per_producer + i)) ) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::size_t total{0};
+    while ( total < producer_count * items_per_producer ) {
+        auto count = queue->drain(queue_capacity);
+        if ( count == 0 ) {
+            std::this_thread::yield();
+        }
+        total += count;
+    }
+    for ( auto& producer : producers ) {
+        producer.join();
+    }
+
+    for ( auto& log : received ) {
+        ASSERT_EQ(items_per_producer, log.size());
+        for ( uintptr_t i = 0; i < items_per_producer; i++ ) {
+            ASSERT_EQ(i, log[i]);
+        }
+    }
+}